@@ -0,0 +1,156 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <iostream>
+#include <optional>
+#include <semaphore>
+#include <thread>
+#include <vector>
+#include "bulk.h"
+
+// Bounded lock-free multi-producer / multi-consumer queue (D. Vyukov's ring buffer).
+// Every cell carries a sequence number telling whether it is ready for a push or a pop,
+// so producers and consumers only CAS on their own cursor and never take a lock.
+template<class T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(std::size_t capacity)
+        : mask_(round_up_pow2(capacity) - 1), cells_(mask_ + 1) {
+        for (std::size_t i = 0; i <= mask_; ++i) cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    BoundedQueue(const BoundedQueue &) = delete;
+    BoundedQueue &operator=(const BoundedQueue &) = delete;
+
+    [[nodiscard]] std::size_t capacity() const noexcept { return mask_ + 1; }
+
+    // Returns false if the queue is full (value is left untouched).
+    bool try_push(T &value) {
+        std::size_t pos = tail_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell &cell = cells_[pos & mask_];
+            const std::size_t seq = cell.sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.value = std::move(value);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // full
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Returns std::nullopt if the queue is empty.
+    std::optional<T> try_pop() {
+        std::size_t pos = head_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell &cell = cells_[pos & mask_];
+            const std::size_t seq = cell.sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0) {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    std::optional<T> out{std::move(cell.value)};
+                    cell.value = T{};
+                    cell.sequence.store(pos + mask_ + 1, std::memory_order_release);
+                    return out;
+                }
+            } else if (diff < 0) {
+                return std::nullopt; // empty
+            } else {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+private:
+    struct Cell {
+        std::atomic<std::size_t> sequence{0};
+        T value{};
+    };
+
+    static std::size_t round_up_pow2(std::size_t n) {
+        std::size_t p = 2;
+        while (p < n) p <<= 1;
+        return p;
+    }
+
+    const std::size_t mask_;
+    std::vector<Cell> cells_;
+    // head/tail on separate cache lines so producers and consumers do not false-share
+    alignas(64) std::atomic<std::size_t> head_{0};
+    alignas(64) std::atomic<std::size_t> tail_{0};
+};
+
+// Decorator that moves a sink off the caller's thread: consume() only enqueues a handle to the Block,
+// a pool of workers drains the queue into the wrapped sink.
+//  - the queue is bounded: when workers fall behind, consume() blocks (back-pressure)
+//    instead of letting memory grow without limit;
+//  - close() (also called by the destructor) lets workers drain everything already queued
+//    and joins them, so no block is lost on EOF.
+// With one worker blocks reach the wrapped sink in order; with several the wrapped
+// sink must be thread-safe.
+class AsyncSink final : public IBlockSink {
+public:
+    AsyncSink(IBlockSink &target, const std::size_t workers, const std::size_t queue_capacity = 1024)
+        : target_(target), queue_(queue_capacity),
+          free_slots_(static_cast<std::ptrdiff_t>(queue_.capacity())) {
+        const std::size_t n = workers == 0 ? 1 : workers;
+        workers_.reserve(n);
+        for (std::size_t i = 0; i < n; ++i) workers_.emplace_back([this] { run(); });
+    }
+
+    AsyncSink(const AsyncSink &) = delete;
+    AsyncSink &operator=(const AsyncSink &) = delete;
+
+    ~AsyncSink() override { close(); }
+
+    void consume(const Block &b) override { consume_shared(std::make_shared<const SharedBlock>(Block(b))); }
+
+    // Queues the shared handle itself - the Block is not copied.
+    void consume_shared(const BlockPtr &b) override {
+        BlockPtr handle = b;
+        free_slots_.acquire(); // waits while the queue is full
+        while (!queue_.try_push(handle)) std::this_thread::yield(); // slot is being vacated by a pop
+        ready_items_.release();
+    }
+
+    // Stops accepting blocks, waits until every queued block reached the wrapped sink.
+    void close() {
+        if (closed_.exchange(true)) return;
+        // one extra token per worker: a worker whose pop finds the queue empty exits
+        ready_items_.release(static_cast<std::ptrdiff_t>(workers_.size()));
+        for (auto &w: workers_) w.join();
+    }
+
+private:
+    void run() {
+        for (;;) {
+            ready_items_.acquire();
+            std::optional<BlockPtr> block;
+            while (!(block = queue_.try_pop())) {
+                // after close() only the shutdown tokens outnumber queued blocks;
+                // before it an empty pop just means a push is still being published
+                if (closed_.load(std::memory_order_acquire)) return;
+                std::this_thread::yield();
+            }
+            free_slots_.release();
+            try {
+                target_.consume_shared(*block);
+            } catch (const std::exception &e) {
+                std::cerr << "Error: sink failed: " << e.what() << '\n';
+            }
+        }
+    }
+
+    IBlockSink &target_;
+    BoundedQueue<BlockPtr> queue_;
+    std::counting_semaphore<> free_slots_;
+    std::counting_semaphore<> ready_items_{0};
+    std::atomic<bool> closed_{false};
+    std::vector<std::thread> workers_;
+};
@@ -0,0 +1,274 @@
+// bulk_bench - load generator and benchmark for the bulk pipeline.
+//
+// Generates a synthetic command stream (static commands mixed with nested dynamic blocks),
+// then measures for BlockBuilder alone and for BlockBuilder + each sink:
+//   - throughput in input lines per second,
+//   - block latency percentiles (first command of a block fed -> sink finished with the block),
+//   - heap allocations per block.
+// Sinks run synchronously here so their own cost is measured; log files go to a temporary directory.
+#include "binary_sinks.h"
+#include "bulk.h"
+#include "dispatcher.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// ---------- allocation counting ----------
+// Every global allocation and deallocation form is replaced, so all pairs match: plain and array,
+// sized, nothrow and aligned. Memory comes from aligned_alloc (also for the unaligned forms) and
+// goes back through release(), kept out of line so GCC does not pair an inlined free() with
+// the new-expression at the call site (-Wmismatched-new-delete).
+namespace {
+    std::atomic<std::uint64_t> g_allocations{0};
+
+    void *counted_alloc(std::size_t size, std::size_t alignment) noexcept {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+        alignment = std::max(alignment, alignof(std::max_align_t));
+        size = (std::max<std::size_t>(size, 1) + alignment - 1) / alignment * alignment; // aligned_alloc rule
+        return std::aligned_alloc(alignment, size);
+    }
+
+    void *counted_alloc_or_throw(const std::size_t size, const std::size_t alignment) {
+        if (void *p = counted_alloc(size, alignment)) return p;
+        throw std::bad_alloc();
+    }
+
+    [[gnu::noinline]] void release(void *p) noexcept { std::free(p); }
+}
+
+void *operator new(const std::size_t size) { return counted_alloc_or_throw(size, 0); }
+void *operator new[](const std::size_t size) { return counted_alloc_or_throw(size, 0); }
+void *operator new(const std::size_t size, const std::nothrow_t &) noexcept { return counted_alloc(size, 0); }
+void *operator new[](const std::size_t size, const std::nothrow_t &) noexcept { return counted_alloc(size, 0); }
+void *operator new(const std::size_t size, const std::align_val_t al) {
+    return counted_alloc_or_throw(size, static_cast<std::size_t>(al));
+}
+void *operator new[](const std::size_t size, const std::align_val_t al) {
+    return counted_alloc_or_throw(size, static_cast<std::size_t>(al));
+}
+void *operator new(const std::size_t size, const std::align_val_t al, const std::nothrow_t &) noexcept {
+    return counted_alloc(size, static_cast<std::size_t>(al));
+}
+void *operator new[](const std::size_t size, const std::align_val_t al, const std::nothrow_t &) noexcept {
+    return counted_alloc(size, static_cast<std::size_t>(al));
+}
+
+void operator delete(void *p) noexcept { release(p); }
+void operator delete[](void *p) noexcept { release(p); }
+void operator delete(void *p, std::size_t) noexcept { release(p); }
+void operator delete[](void *p, std::size_t) noexcept { release(p); }
+void operator delete(void *p, const std::nothrow_t &) noexcept { release(p); }
+void operator delete[](void *p, const std::nothrow_t &) noexcept { release(p); }
+void operator delete(void *p, std::align_val_t) noexcept { release(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { release(p); }
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept { release(p); }
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept { release(p); }
+void operator delete(void *p, std::align_val_t, const std::nothrow_t &) noexcept { release(p); }
+void operator delete[](void *p, std::align_val_t, const std::nothrow_t &) noexcept { release(p); }
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    struct BenchOptions {
+        std::size_t lines = 1'000'000;
+        std::size_t block_size = 3;     // static block size N
+        double dynamic_ratio = 0.2;     // probability that the next group of commands is a dynamic block
+        std::size_t max_depth = 3;      // maximum {} nesting of a dynamic block
+        std::size_t dynamic_len = 10;   // mean number of commands in a dynamic block
+        std::size_t command_len = 16;   // bytes per command
+        std::string sinks = "null,console,file,segment,binary,compressed";
+        unsigned seed = 42;
+    };
+
+    // Static commands interleaved with dynamic blocks of random length and nesting depth.
+    std::vector<std::string> generate(const BenchOptions &opt) {
+        std::mt19937 rng(opt.seed);
+        std::bernoulli_distribution dynamic(opt.dynamic_ratio);
+        std::uniform_int_distribution<std::size_t> depth(1, std::max<std::size_t>(opt.max_depth, 1));
+        std::poisson_distribution<std::size_t> dyn_len(static_cast<double>(opt.dynamic_len));
+        std::vector<std::string> out;
+        out.reserve(opt.lines + opt.lines / 4);
+        std::size_t n = 0;
+        auto command = [&] {
+            std::string c = "cmd" + std::to_string(n++);
+            c.resize(std::max(c.size(), opt.command_len), 'x');
+            return c;
+        };
+        while (out.size() < opt.lines) {
+            if (!dynamic(rng)) {
+                for (std::size_t i = 0; i < opt.block_size; ++i) out.push_back(command());
+                continue;
+            }
+            const std::size_t d = depth(rng);
+            for (std::size_t i = 0; i < d; ++i) out.emplace_back("{");
+            for (std::size_t i = 0, len = dyn_len(rng) + 1; i < len; ++i) {
+                out.push_back(command());
+                if (d > 1 && i == len / 2) { // some commands between an inner close and the outer one
+                    out.emplace_back("}");
+                    out.emplace_back("{");
+                }
+            }
+            for (std::size_t i = 0; i < d; ++i) out.emplace_back("}");
+        }
+        return out;
+    }
+
+    class NullSink final : public IBlockSink {
+    public:
+        void consume(const Block &) override {
+        }
+    };
+
+    struct Result {
+        std::string name;
+        double lines_per_sec = 0;
+        std::size_t blocks = 0;
+        double allocs_per_block = 0;
+        std::vector<double> latencies_us;
+    };
+
+    double percentile(std::vector<double> &v, const double p) {
+        if (v.empty()) return 0;
+        const auto k = static_cast<std::size_t>(p * static_cast<double>(v.size() - 1));
+        std::nth_element(v.begin(), v.begin() + static_cast<std::ptrdiff_t>(k), v.end());
+        return v[k];
+    }
+
+    // Feeds the whole stream through a BlockBuilder and, unless sink is null, the dispatcher.
+    Result run(const std::string &name, const std::vector<std::string> &stream, const std::size_t block_size,
+               std::unique_ptr<IBlockSink> sink) {
+        Result r;
+        r.name = name;
+        r.latencies_us.reserve(stream.size() / std::max<std::size_t>(block_size, 1) + 1);
+
+        const auto pool = CommandPool::create();
+        BlockBuilder builder(block_size, pool);
+        BlockDispatcher dispatcher(pool);
+        if (sink) dispatcher.add_sink(std::move(sink));
+
+        Block block;
+        Clock::time_point block_start{};
+        bool in_block = false;
+        auto emit = [&] {
+            dispatcher.dispatch(block);
+            r.latencies_us.push_back(std::chrono::duration<double, std::micro>(Clock::now() - block_start).count());
+            ++r.blocks;
+            in_block = false;
+        };
+
+        const std::uint64_t allocs_before = g_allocations.load();
+        const auto start = Clock::now();
+        for (const auto &line: stream) {
+            if (!in_block && line != "{" && line != "}") {
+                block_start = Clock::now();
+                in_block = true;
+            }
+            if (builder.feed_line(line, block)) emit();
+        }
+        if (builder.finish(block)) emit();
+        const auto elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        const std::uint64_t allocs = g_allocations.load() - allocs_before;
+
+        r.lines_per_sec = static_cast<double>(stream.size()) / elapsed;
+        r.allocs_per_block = r.blocks ? static_cast<double>(allocs) / static_cast<double>(r.blocks) : 0;
+        return r;
+    }
+
+    std::unique_ptr<IBlockSink> make_sink(const std::string &name) {
+        if (name == "null") return std::make_unique<NullSink>();
+        if (name == "console") return std::make_unique<ConsoleSink>();
+        if (name == "file") return std::make_unique<FileSink>();
+        if (name == "segment") return std::make_unique<SegmentFileSink>(64 << 20);
+        if (name == "binary") return std::make_unique<BinarySegmentSink>(64 << 20);
+        if (name == "compressed") return std::make_unique<CompressedSink>();
+        throw std::runtime_error("unknown sink: " + name);
+    }
+
+    bool parse(const int argc, char *argv[], BenchOptions &opt) {
+        for (int i = 1; i + 1 < argc; i += 2) {
+            const std::string key = argv[i];
+            const std::string value = argv[i + 1];
+            if (key == "--lines") opt.lines = std::stoul(value);
+            else if (key == "--block-size") opt.block_size = std::stoul(value);
+            else if (key == "--dynamic-ratio") opt.dynamic_ratio = std::stod(value);
+            else if (key == "--max-depth") opt.max_depth = std::stoul(value);
+            else if (key == "--dynamic-len") opt.dynamic_len = std::stoul(value);
+            else if (key == "--command-len") opt.command_len = std::stoul(value);
+            else if (key == "--sinks") opt.sinks = value;
+            else if (key == "--seed") opt.seed = static_cast<unsigned>(std::stoul(value));
+            else return false;
+        }
+        return argc % 2 == 1 && opt.block_size > 0;
+    }
+}
+
+int main(const int argc, char *argv[]) {
+    BenchOptions opt;
+    try {
+        if (!parse(argc, argv, opt)) {
+            std::cerr << "Usage: " << argv[0]
+                    << " [--lines n] [--block-size n] [--dynamic-ratio p] [--max-depth n] [--dynamic-len n]"
+                       " [--command-len bytes] [--sinks null,console,file,segment,binary,compressed] [--seed n]\n";
+            return 1;
+        }
+    } catch (const std::exception &) {
+        std::cerr << "Invalid option value\n";
+        return 1;
+    }
+
+    const auto stream = generate(opt);
+    std::cout << "stream: " << stream.size() << " lines, block size " << opt.block_size
+            << ", dynamic ratio " << opt.dynamic_ratio << ", max depth " << opt.max_depth << "\n\n";
+
+    // log files of the file sinks are written into a scratch directory, removed afterwards
+    const auto cwd = std::filesystem::current_path();
+    const auto scratch = std::filesystem::temp_directory_path() / ("bulk_bench_" + std::to_string(::getpid()));
+    std::filesystem::create_directories(scratch);
+    std::filesystem::current_path(scratch);
+
+    std::vector<Result> results;
+    results.push_back(run("builder", stream, opt.block_size, nullptr));
+
+    std::stringstream names(opt.sinks);
+    for (std::string name; std::getline(names, name, ',');) {
+        // console output would flood the terminal: send it to a discarded buffer instead
+        std::ostringstream discard;
+        auto *saved = name == "console" ? std::cout.rdbuf(discard.rdbuf()) : nullptr;
+        try {
+            results.push_back(run(name, stream, opt.block_size, make_sink(name)));
+        } catch (const std::exception &e) {
+            if (saved) std::cout.rdbuf(saved);
+            std::cerr << "Error: " << e.what() << '\n';
+            continue;
+        }
+        if (saved) std::cout.rdbuf(saved);
+    }
+
+    std::filesystem::current_path(cwd);
+    std::filesystem::remove_all(scratch);
+
+    std::cout << std::left << std::setw(12) << "stage" << std::right
+            << std::setw(14) << "lines/s" << std::setw(10) << "blocks"
+            << std::setw(11) << "p50 us" << std::setw(11) << "p99 us" << std::setw(11) << "p99.9 us"
+            << std::setw(11) << "max us" << std::setw(14) << "allocs/block" << '\n';
+    for (auto &r: results) {
+        std::cout << std::left << std::setw(12) << r.name << std::right << std::fixed << std::setprecision(0)
+                << std::setw(14) << r.lines_per_sec << std::setw(10) << r.blocks << std::setprecision(2)
+                << std::setw(11) << percentile(r.latencies_us, 0.5)
+                << std::setw(11) << percentile(r.latencies_us, 0.99)
+                << std::setw(11) << percentile(r.latencies_us, 0.999)
+                << std::setw(11) << percentile(r.latencies_us, 1.0)
+                << std::setw(14) << r.allocs_per_block << '\n';
+    }
+    return 0;
+}
@@ -0,0 +1,127 @@
+#pragma once
+#include <fstream>
+#include <mutex>
+#include <string>
+#include "block_codec.h"
+#include "bulk.h"
+
+// Magic numbers at the start of binary log files (see block_codec.h for the record layout).
+constexpr std::string_view BINARY_MAGIC = "BULKBIN1";     // followed by block records
+constexpr std::string_view COMPRESSED_MAGIC = "BULKCMP1"; // followed by u8 codec id and frames
+
+// Opens a new log file "<prefix><timestamp>_<n><extension>" that did not exist before.
+inline bool open_unique(std::ofstream &out, const std::string &prefix, const std::time_t timestamp,
+                        std::size_t &sequence, const std::string &extension) {
+    for (int attempt = 0; attempt < 64; ++attempt) {
+        out.clear();
+        out.open(prefix + std::to_string(timestamp) + "_" + std::to_string(sequence++) + extension,
+                 std::ios::out | std::ios::binary | std::ios::noreplace);
+        if (out) return true;
+    }
+    std::cerr << "Error: could not create a " << extension << " log file\n";
+    return false;
+}
+
+// Writes blocks as length-prefixed binary records to segment files bulk_segment<timestamp>_<n>.bin.
+//  - records are collected in memory and written batch_bytes at a time (one write per batch);
+//  - a new segment is started once the current one reaches max_segment_bytes.
+// Safe to call from several threads at once, but records land in the order consume() is entered:
+// feed it from one worker to keep the blocks in order.
+class BinarySegmentSink final : public IBlockSink {
+public:
+    explicit BinarySegmentSink(const std::size_t max_segment_bytes, const std::size_t batch_bytes = 256 * 1024)
+        : max_segment_bytes_(max_segment_bytes), batch_bytes_(batch_bytes) {
+        batch_.reserve(batch_bytes_ + 4096);
+    }
+
+    ~BinarySegmentSink() override {
+        std::lock_guard lock(mutex_);
+        write_batch();
+    }
+
+    void consume(const Block &b) override {
+        std::lock_guard lock(mutex_);
+        if (!out_.is_open() || segment_bytes_ >= max_segment_bytes_) {
+            write_batch();
+            out_.close();
+            if (!open_unique(out_, "bulk_segment", b.timestamp, sequence_, ".bin")) return;
+            out_.write(BINARY_MAGIC.data(), BINARY_MAGIC.size());
+            segment_bytes_ = BINARY_MAGIC.size();
+        }
+        const std::size_t before = batch_.size();
+        block_codec::append_record(batch_, b);
+        segment_bytes_ += batch_.size() - before;
+        if (batch_.size() >= batch_bytes_) write_batch();
+    }
+
+private:
+    void write_batch() {
+        if (!batch_.empty() && out_.is_open()) {
+            out_.write(batch_.data(), static_cast<std::streamsize>(batch_.size()));
+            out_.flush();
+        }
+        batch_.clear();
+    }
+
+    const std::size_t max_segment_bytes_;
+    const std::size_t batch_bytes_;
+    std::mutex mutex_;
+    std::ofstream out_;
+    std::string batch_;
+    std::size_t segment_bytes_ = 0;
+    std::size_t sequence_ = 0;
+};
+
+// Streams blocks into one compressed file bulk<timestamp>_<n>.bcz.
+//  - records are collected into batches of batch_bytes; every batch is compressed as one frame:
+//    u32 raw size | u32 compressed size | compressed bytes;
+//  - the codec is zstd when built with BULK_WITH_ZSTD, otherwise the built-in LZ codec;
+//    its id is stored in the header, so bulk_replay can read either.
+// Safe to call from several threads at once, but records land in the order consume() is entered:
+// feed it from one worker to keep the blocks in order.
+class CompressedSink final : public IBlockSink {
+public:
+    explicit CompressedSink(const std::size_t batch_bytes = 1 << 20,
+                            const block_codec::Codec codec = block_codec::DEFAULT_CODEC)
+        : batch_bytes_(batch_bytes), codec_(codec) {
+        batch_.reserve(batch_bytes_ + 4096);
+    }
+
+    ~CompressedSink() override {
+        std::lock_guard lock(mutex_);
+        write_frame();
+    }
+
+    void consume(const Block &b) override {
+        std::lock_guard lock(mutex_);
+        if (!out_.is_open()) {
+            if (!open_unique(out_, "bulk", b.timestamp, sequence_, ".bcz")) return;
+            out_.write(COMPRESSED_MAGIC.data(), COMPRESSED_MAGIC.size());
+            out_.put(static_cast<char>(codec_));
+        }
+        block_codec::append_record(batch_, b);
+        if (batch_.size() >= batch_bytes_) write_frame();
+    }
+
+private:
+    void write_frame() {
+        if (batch_.empty() || !out_.is_open()) return;
+        frame_.clear();
+        block_codec::put_u32(frame_, static_cast<std::uint32_t>(batch_.size()));
+        block_codec::put_u32(frame_, 0); // patched below
+        block_codec::compress(codec_, batch_, frame_);
+        const auto compressed = static_cast<std::uint32_t>(frame_.size() - 8);
+        for (int i = 0; i < 4; ++i) frame_[4 + i] = static_cast<char>(compressed >> (8 * i));
+        out_.write(frame_.data(), static_cast<std::streamsize>(frame_.size()));
+        out_.flush();
+        batch_.clear();
+    }
+
+    const std::size_t batch_bytes_;
+    const block_codec::Codec codec_;
+    std::mutex mutex_;
+    std::ofstream out_;
+    std::string batch_; // uncompressed records of the current frame
+    std::string frame_; // reused output buffer
+    std::size_t sequence_ = 0;
+};
@@ -0,0 +1,200 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#if defined(BULK_WITH_ZSTD)
+#include <zstd.h>
+#endif
+#include "bulk.h"
+
+// Binary representation of blocks shared by the binary / compressed sinks and the replay tool.
+//
+// Block record (all integers little-endian):
+//     u64 timestamp | u32 command count | { u32 length | bytes } per command
+namespace block_codec {
+    inline void put_u32(std::string &out, const std::uint32_t v) {
+        const char bytes[4] = {
+            static_cast<char>(v), static_cast<char>(v >> 8), static_cast<char>(v >> 16), static_cast<char>(v >> 24)
+        };
+        out.append(bytes, 4);
+    }
+
+    inline void put_u64(std::string &out, const std::uint64_t v) {
+        put_u32(out, static_cast<std::uint32_t>(v));
+        put_u32(out, static_cast<std::uint32_t>(v >> 32));
+    }
+
+    inline std::uint32_t get_u32(const unsigned char *p) {
+        return static_cast<std::uint32_t>(p[0]) | static_cast<std::uint32_t>(p[1]) << 8 |
+               static_cast<std::uint32_t>(p[2]) << 16 | static_cast<std::uint32_t>(p[3]) << 24;
+    }
+
+    inline std::uint64_t get_u64(const unsigned char *p) {
+        return static_cast<std::uint64_t>(get_u32(p)) | static_cast<std::uint64_t>(get_u32(p + 4)) << 32;
+    }
+
+    inline void append_record(std::string &out, const Block &b) {
+        put_u64(out, static_cast<std::uint64_t>(b.timestamp));
+        put_u32(out, static_cast<std::uint32_t>(b.commands.size()));
+        for (const std::string_view c: b.commands) {
+            put_u32(out, static_cast<std::uint32_t>(c.size()));
+            out.append(c);
+        }
+    }
+
+    // Decodes one record starting at pos; returns false if fewer bytes than a full record remain.
+    inline bool read_record(const std::string_view data, std::size_t &pos, Block &b) {
+        const auto *p = reinterpret_cast<const unsigned char *>(data.data());
+        auto need = [&](const std::size_t n) { return data.size() - pos >= n; };
+        if (!need(12)) return false;
+        b.timestamp = static_cast<std::time_t>(get_u64(p + pos));
+        const std::uint32_t count = get_u32(p + pos + 8);
+        std::size_t at = pos + 12;
+        b.commands.clear();
+        for (std::uint32_t i = 0; i < count; ++i) {
+            if (data.size() - at < 4) return false;
+            const std::uint32_t len = get_u32(p + at);
+            at += 4;
+            if (data.size() - at < len) return false;
+            b.commands.push_back(data.substr(at, len));
+            at += len;
+        }
+        pos = at;
+        return true;
+    }
+
+    // ---------------------------------------------------------------------------------------------
+    // Built-in LZ77 codec (LZ4-style sequences), used when zstd is not available.
+    // Sequence: token (literal length << 4 | match length - 4), extra length bytes (255...) if a
+    // nibble is 15, literals, u16 offset, extra match length bytes. The last sequence has literals only.
+    // ---------------------------------------------------------------------------------------------
+    namespace lz {
+        constexpr std::size_t MIN_MATCH = 4;
+        constexpr std::size_t MAX_OFFSET = 65535;
+        constexpr int HASH_BITS = 14;
+
+        inline std::uint32_t load32(const char *p) {
+            std::uint32_t v;
+            std::memcpy(&v, p, 4);
+            return v;
+        }
+
+        inline std::uint32_t hash(const std::uint32_t v) { return (v * 2654435761u) >> (32 - HASH_BITS); }
+
+        inline void put_length(std::string &out, std::size_t extra) {
+            for (; extra >= 255; extra -= 255) out.push_back(static_cast<char>(255));
+            out.push_back(static_cast<char>(extra));
+        }
+
+        inline void put_sequence(std::string &out, const char *literals, const std::size_t lit_len,
+                                 const std::size_t offset, const std::size_t match_len) {
+            const std::size_t m = match_len == 0 ? 0 : match_len - MIN_MATCH;
+            out.push_back(static_cast<char>((std::min<std::size_t>(lit_len, 15) << 4) | std::min<std::size_t>(m, 15)));
+            if (lit_len >= 15) put_length(out, lit_len - 15);
+            out.append(literals, lit_len);
+            if (match_len == 0) return; // last sequence
+            out.push_back(static_cast<char>(offset));
+            out.push_back(static_cast<char>(offset >> 8));
+            if (m >= 15) put_length(out, m - 15);
+        }
+
+        inline void compress(const std::string_view in, std::string &out) {
+            std::vector<std::int64_t> table(std::size_t{1} << HASH_BITS, -1);
+            const char *src = in.data();
+            const std::size_t n = in.size();
+            std::size_t anchor = 0;
+            std::size_t ip = 0;
+            while (ip + MIN_MATCH <= n) {
+                const std::uint32_t seq = load32(src + ip);
+                const std::uint32_t h = hash(seq);
+                const std::int64_t cand = table[h];
+                table[h] = static_cast<std::int64_t>(ip);
+                if (cand >= 0 && ip - static_cast<std::size_t>(cand) <= MAX_OFFSET &&
+                    load32(src + cand) == seq) {
+                    std::size_t len = MIN_MATCH;
+                    while (ip + len < n && src[cand + len] == src[ip + len]) ++len;
+                    put_sequence(out, src + anchor, ip - anchor, ip - static_cast<std::size_t>(cand), len);
+                    ip += len;
+                    anchor = ip;
+                } else {
+                    ++ip;
+                }
+            }
+            put_sequence(out, src + anchor, n - anchor, 0, 0);
+        }
+
+        inline void decompress(const std::string_view in, std::string &out, const std::size_t raw_size) {
+            const auto *p = reinterpret_cast<const unsigned char *>(in.data());
+            const std::size_t n = in.size();
+            const std::size_t base = out.size();
+            out.reserve(base + raw_size);
+            std::size_t ip = 0;
+            auto corrupt = [] { throw std::runtime_error("corrupt compressed frame"); };
+            auto read_length = [&](std::size_t len) {
+                for (;;) {
+                    if (ip >= n) corrupt();
+                    const unsigned char b = p[ip++];
+                    len += b;
+                    if (b != 255) return len;
+                }
+            };
+            while (ip < n) {
+                const unsigned char token = p[ip++];
+                std::size_t lit_len = token >> 4;
+                if (lit_len == 15) lit_len = read_length(lit_len);
+                if (n - ip < lit_len) corrupt();
+                out.append(in.data() + ip, lit_len);
+                ip += lit_len;
+                if (ip == n) break; // last sequence
+                if (n - ip < 2) corrupt();
+                const std::size_t offset = p[ip] | static_cast<std::size_t>(p[ip + 1]) << 8;
+                ip += 2;
+                std::size_t match_len = token & 15;
+                if (match_len == 15) match_len = read_length(match_len);
+                match_len += MIN_MATCH;
+                if (offset == 0 || offset > out.size() - base) corrupt();
+                // byte by byte: a match may overlap the bytes it produces
+                std::size_t from = out.size() - offset;
+                for (std::size_t i = 0; i < match_len; ++i) out.push_back(out[from++]);
+            }
+            if (out.size() - base != raw_size) corrupt();
+        }
+    }
+
+    // Codec identifiers stored in the compressed file header.
+    enum class Codec : std::uint8_t { LZ = 1, ZSTD = 2 };
+
+#if defined(BULK_WITH_ZSTD)
+    constexpr Codec DEFAULT_CODEC = Codec::ZSTD;
+#else
+    constexpr Codec DEFAULT_CODEC = Codec::LZ;
+#endif
+
+    inline void compress(const Codec codec, const std::string_view in, std::string &out) {
+        if (codec == Codec::LZ) return lz::compress(in, out);
+#if defined(BULK_WITH_ZSTD)
+        const std::size_t base = out.size();
+        out.resize(base + ZSTD_compressBound(in.size()));
+        const std::size_t got = ZSTD_compress(out.data() + base, out.size() - base, in.data(), in.size(), 1);
+        if (ZSTD_isError(got)) throw std::runtime_error(ZSTD_getErrorName(got));
+        out.resize(base + got);
+#else
+        throw std::runtime_error("built without zstd support");
+#endif
+    }
+
+    inline void decompress(const Codec codec, const std::string_view in, std::string &out, const std::size_t raw_size) {
+        if (codec == Codec::LZ) return lz::decompress(in, out, raw_size);
+#if defined(BULK_WITH_ZSTD)
+        const std::size_t base = out.size();
+        out.resize(base + raw_size);
+        const std::size_t got = ZSTD_decompress(out.data() + base, raw_size, in.data(), in.size());
+        if (ZSTD_isError(got) || got != raw_size) throw std::runtime_error("corrupt compressed frame");
+#else
+        throw std::runtime_error("file is zstd-compressed, but this build has no zstd support");
+#endif
+    }
+}
@@ -1,77 +1,492 @@
 #pragma once
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <vector>
 #include <ctime>
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <stdexcept>
+#include <iterator>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Commands of one block stored back to back in a single buffer (a per-block arena): adding a
+// command is one memcpy instead of a string allocation, and a recycled list (see CommandPool)
+// makes a steady stream of blocks allocation-free. Commands are read back as string_views.
+class CommandList {
+public:
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::string_view;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const std::string_view *;
+        using reference = std::string_view;
+
+        const_iterator() = default;
+
+        const_iterator(const CommandList *list, const std::size_t i) : list_(list), i_(i) {
+        }
+
+        std::string_view operator*() const { return (*list_)[i_]; }
+
+        const_iterator &operator++() {
+            ++i_;
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            auto tmp = *this;
+            ++i_;
+            return tmp;
+        }
+
+        bool operator==(const const_iterator &other) const { return i_ == other.i_; }
+        bool operator!=(const const_iterator &other) const { return i_ != other.i_; }
+
+    private:
+        const CommandList *list_ = nullptr;
+        std::size_t i_ = 0;
+    };
+
+    void push_back(const std::string_view command) {
+        arena_.append(command);
+        ends_.push_back(arena_.size());
+    }
+
+    // Appends all commands of another list after the ones already stored.
+    void append(const CommandList &other) {
+        const std::size_t base = arena_.size();
+        arena_.append(other.arena_);
+        for (const std::size_t end: other.ends_) ends_.push_back(base + end);
+    }
+
+    [[nodiscard]] std::string_view operator[](const std::size_t i) const {
+        const std::size_t start = i == 0 ? 0 : ends_[i - 1];
+        return {arena_.data() + start, ends_[i] - start};
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept { return ends_.size(); }
+    [[nodiscard]] bool empty() const noexcept { return ends_.empty(); }
+    [[nodiscard]] std::size_t bytes() const noexcept { return arena_.size(); } // total size of all commands
+
+    // Keeps the capacity, so a recycled list does not allocate again.
+    void clear() noexcept {
+        arena_.clear();
+        ends_.clear();
+    }
+
+    [[nodiscard]] const_iterator begin() const { return {this, 0}; }
+    [[nodiscard]] const_iterator end() const { return {this, ends_.size()}; }
+
+private:
+    std::string arena_;             // all commands concatenated
+    std::vector<std::size_t> ends_; // end offset of every command in arena_
+};
 
 // Finished block of commands
 struct Block {
-    std::vector<std::string> commands;
+    CommandList commands;
     std::time_t timestamp; // epoch seconds of the first command to include in log file name
 };
 
+// Text form of a block as written by console and text file sinks: "bulk: a, b, c\n".
+inline std::string format_block(const Block &b) {
+    std::string text;
+    text.reserve(b.commands.bytes() + 2 * b.commands.size() + 7);
+    text += "bulk: ";
+    for (std::size_t i = 0; i < b.commands.size(); ++i) {
+        if (i) text += ", ";
+        text += b.commands[i];
+    }
+    text += '\n';
+    return text;
+}
+
+class CommandPool;
+
+// A finished block as handed to the sinks: immutable and shared by all of them (and across threads),
+// so its commands are never copied. Its text form is formatted at most once - by the first sink that
+// asks for it - and reused by every other text sink; if no sink needs text it is never formatted.
+class SharedBlock {
+public:
+    explicit SharedBlock(Block &&b) : block_(std::move(b)) {
+    }
+
+    [[nodiscard]] const Block &block() const noexcept { return block_; }
+
+    [[nodiscard]] const std::string &text() const {
+        std::call_once(text_once_, [this] { text_ = format_block(block_); });
+        return text_;
+    }
+
+private:
+    friend class CommandPool; // takes the command list back when the block dies
+
+    Block block_;
+    mutable std::once_flag text_once_;
+    mutable std::string text_;
+};
+
+// Shared immutable handle to a finished block.
+using BlockPtr = std::shared_ptr<const SharedBlock>;
+
+// Recycles command lists of consumed blocks: when the last BlockPtr to a Block goes away its
+// list (cleared, capacity kept) returns here and is reused by BlockBuilder for a later block.
+// Safe to use from several threads at once.
+class CommandPool : public std::enable_shared_from_this<CommandPool> {
+public:
+    static std::shared_ptr<CommandPool> create() { return std::shared_ptr<CommandPool>(new CommandPool); }
+
+    CommandList acquire() {
+        std::lock_guard lock(mutex_);
+        if (free_.empty()) return {};
+        auto v = std::move(free_.back());
+        free_.pop_back();
+        return v;
+    }
+
+    void release(CommandList &&v) {
+        v.clear();
+        std::lock_guard lock(mutex_);
+        if (free_.size() < MAX_POOLED) free_.push_back(std::move(v));
+    }
+
+    // Moves the block into a shared handle whose last owner gives the command list back to the pool.
+    BlockPtr share(Block &&b) {
+        auto *owned = new SharedBlock(std::move(b));
+        return BlockPtr(owned, [pool = shared_from_this()](const SharedBlock *p) {
+            auto *shared = const_cast<SharedBlock *>(p);
+            pool->release(std::move(shared->block_.commands));
+            delete shared;
+        });
+    }
+
+private:
+    CommandPool() = default;
+
+    static constexpr std::size_t MAX_POOLED = 64; // enough for the blocks in flight in the sink queues
+    std::mutex mutex_;
+    std::vector<CommandList> free_;
+};
+
 // Abstraction of Block consumers
 class IBlockSink {
 public:
     virtual ~IBlockSink() = default;
     virtual void consume(const Block &) = 0;
+
+    // Entry point used by dispatchers. Sinks that keep the block beyond the call (e.g. queue it)
+    // or can reuse its cached text override this instead of working on a plain Block.
+    virtual void consume_shared(const BlockPtr &b) { consume(b->block()); }
+};
+
+// Base of the sinks that output the "bulk: a, b, c" text form. A dispatched block brings its
+// shared, formatted-once text; a plain Block is formatted on the spot.
+class TextSink : public IBlockSink {
+public:
+    void consume(const Block &b) final { write(b, format_block(b)); }
+    void consume_shared(const BlockPtr &b) override { write(b->block(), b->text()); }
+
+protected:
+    virtual void write(const Block &b, std::string_view text) = 0;
 };
 
 // Concrete Consol consumer - Responsible for displaying a Block on console
-class ConsoleSink final : public IBlockSink {
+class ConsoleSink final : public TextSink {
+protected:
+    void write(const Block &, const std::string_view text) override {
+        std::cout.write(text.data(), static_cast<std::streamsize>(text.size()));
+    };
+};
+
+// Concrete File consumer - Responsible for saving a Block in a log file
+// File names are bulk<timestamp>_<sequence>.log: the sequence number makes blocks started within
+// the same second land in different files, and files are opened in no-replace mode so a name left
+// over from a previous run is never overwritten (the sequence is bumped instead).
+// The text is written to "<name>.tmp" and renamed over the (reserved, empty) name, so a crash never
+// leaves a truncated log: a file is either complete or empty. If writing or renaming fails both the
+// reserved name and the .tmp file are removed.
+// Durable mode (for the WAL, which must only mark a block done once its log is on disk): the .tmp file
+// is fsync'ed before the rename, and a dispatched block is only let go - reported done - after the
+// directory holding its rename is fsync'ed. That happens once every sync_interval for all blocks
+// renamed in it (group commit), not once per file. By default nothing is synced: one buffered write.
+// Safe to call from several threads at once.
+class FileSink final : public TextSink {
 public:
-    void consume(const Block &b) override {
-        std::cout << "bulk: ";
-        for (std::size_t i = 0; i < b.commands.size(); ++i) {
-            if (i) std::cout << ", ";
-            std::cout << b.commands[i];
+    FileSink() = default;
+
+    explicit FileSink(const std::chrono::milliseconds sync_interval)
+        : durable_(true), sync_interval_(sync_interval), syncer_([this] { run_syncer(); }) {
+    }
+
+    FileSink(const FileSink &) = delete;
+    FileSink &operator=(const FileSink &) = delete;
+
+    ~FileSink() override {
+        if (!durable_) return;
+        {
+            std::lock_guard lock(mutex_);
+            stopping_ = true;
         }
-        std::cout << '\n';
+        wake_.notify_one();
+        syncer_.join();
+    }
+
+    // Holds a dispatched block until the directory sync that covers its rename.
+    void consume_shared(const BlockPtr &b) override {
+        TextSink::consume_shared(b);
+        if (!durable_) return;
+        std::lock_guard lock(mutex_);
+        renamed_.push_back(b);
+    }
+
+protected:
+    void write(const Block &b, const std::string_view text) override {
+        for (int attempt = 0; attempt < MAX_OPEN_ATTEMPTS; ++attempt) {
+            const std::string fn = "bulk" + std::to_string(b.timestamp) + "_" +
+                                   std::to_string(sequence_.fetch_add(1, std::memory_order_relaxed)) + ".log";
+            if (!std::ofstream(fn, std::ios::out | std::ios::noreplace))
+                continue; // most likely exists already - try the next sequence number
+            const std::string tmp = fn + ".tmp";
+            std::error_code ec;
+            bool ok = durable_ ? write_synced(tmp, text) : write_buffered(tmp, text);
+            if (ok) std::filesystem::rename(tmp, fn, ec);
+            if (!ok || ec) {
+                std::cerr << "Error: could not write file " << fn << '\n';
+                std::filesystem::remove(tmp, ec);
+                std::filesystem::remove(fn, ec);
+            }
+            return;
+        }
+        std::cerr << "Error: could not create a log file for block " << b.timestamp << '\n';
     };
+
+private:
+    static constexpr int MAX_OPEN_ATTEMPTS = 64;
+
+    static bool write_buffered(const std::string &path, const std::string_view text) {
+        std::ofstream out(path, std::ios::out | std::ios::trunc);
+        out.write(text.data(), static_cast<std::streamsize>(text.size()));
+        out.close();
+        return static_cast<bool>(out);
+    }
+
+    // creates (or truncates) path, writes text and fsyncs it
+    static bool write_synced(const std::string &path, const std::string_view text) {
+        const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) return false;
+        bool ok = true;
+        for (std::size_t off = 0; ok && off < text.size();) {
+            const ssize_t n = ::write(fd, text.data() + off, text.size() - off);
+            if (n > 0) off += static_cast<std::size_t>(n);
+            else ok = n < 0 && errno == EINTR;
+        }
+        ok = ok && ::fsync(fd) == 0;
+        return ::close(fd) == 0 && ok;
+    }
+
+    // makes the renames inside dir durable
+    static bool sync_directory(const char *dir) {
+        const int fd = ::open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd < 0) return false;
+        const bool ok = ::fsync(fd) == 0;
+        return ::close(fd) == 0 && ok;
+    }
+
+    // Every sync_interval: one directory fsync for the blocks renamed since the last one, then lets them go.
+    void run_syncer() {
+        std::vector<BlockPtr> batch;
+        for (bool last = false; !last;) {
+            {
+                std::unique_lock lock(mutex_);
+                wake_.wait_for(lock, sync_interval_, [this] { return stopping_; });
+                batch.swap(renamed_);
+                last = stopping_;
+            }
+            if (batch.empty()) continue;
+            if (!sync_directory(".")) std::cerr << "Error: could not sync the log directory\n";
+            batch.clear(); // the blocks are done
+        }
+    }
+
+    const bool durable_ = false;
+    const std::chrono::milliseconds sync_interval_{0};
+    std::atomic<std::uint64_t> sequence_{0};
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::vector<BlockPtr> renamed_; // durable: blocks whose rename is not synced yet
+    bool stopping_ = false;
+    std::thread syncer_;
 };
 
-// Concrete File consumer - Responsible for saving a Block in a log file
-class FileSink final : public IBlockSink {
+// Concrete File consumer that appends many blocks to one segment file instead of creating a file per block.
+//  - segment files are bulk_segment<timestamp>_<n>.log; a new one is started once the current
+//    one reaches max_segment_bytes;
+//  - next to each segment an index file (same name, .idx) gets one line per block:
+//    "<block timestamp> <byte offset> <byte length> <number of commands>";
+//  - both streams keep a large buffer, so writing a block is a memcpy and the disk sees a few big writes.
+// Safe to call from several threads at once (blocks are serialised by a mutex), but blocks land in the
+// order write() is entered: feed it from one worker to keep segments and index in block order.
+class SegmentFileSink final : public TextSink {
 public:
-    void consume(const Block &b) override {
-        std::ostringstream fn;
-        fn << "bulk" << b.timestamp << ".log";
+    explicit SegmentFileSink(const std::size_t max_segment_bytes, const std::size_t buffer_bytes = 1 << 20)
+        : max_segment_bytes_(max_segment_bytes), data_buffer_(buffer_bytes), index_buffer_(buffer_bytes / 8) {
+    }
+
+    ~SegmentFileSink() override { close_segment(); }
+
+    // Writes out buffered data of the current segment.
+    void flush() {
+        std::lock_guard lock(mutex_);
+        if (data_.is_open()) data_.flush();
+        if (index_.is_open()) index_.flush();
+    }
 
-        std::ofstream out(fn.str(), std::ios::out | std::ios::trunc);
-        if (!out) {
-            std::cerr << "Error: could not open file " << fn.str() << '\n';
+protected:
+    void write(const Block &b, const std::string_view text) override {
+        std::lock_guard lock(mutex_);
+        if (!data_.is_open() || segment_offset_ >= max_segment_bytes_) open_segment(b.timestamp);
+        if (!data_) return;
+
+        data_.write(text.data(), static_cast<std::streamsize>(text.size()));
+        index_ << b.timestamp << ' ' << segment_offset_ << ' ' << text.size() << ' ' << b.commands.size() << '\n';
+        segment_offset_ += text.size();
+    }
+
+private:
+    void open_segment(const std::time_t timestamp) {
+        close_segment();
+        for (int attempt = 0; attempt < 64; ++attempt) {
+            const std::string base = "bulk_segment" + std::to_string(timestamp) + "_" + std::to_string(segment_no_++);
+            // buffers must be installed before the file is opened to take effect
+            data_.rdbuf()->pubsetbuf(data_buffer_.data(), static_cast<std::streamsize>(data_buffer_.size()));
+            data_.open(base + ".log", std::ios::out | std::ios::binary | std::ios::noreplace);
+            if (!data_) {
+                data_.clear();
+                continue;
+            }
+            index_.rdbuf()->pubsetbuf(index_buffer_.data(), static_cast<std::streamsize>(index_buffer_.size()));
+            index_.open(base + ".idx", std::ios::out | std::ios::trunc);
+            if (!index_) std::cerr << "Error: could not open file " << base << ".idx\n";
+            segment_offset_ = 0;
             return;
         }
+        std::cerr << "Error: could not create a segment file\n";
+        data_.setstate(std::ios::failbit);
+    }
+
+    void close_segment() {
+        if (data_.is_open()) data_.close();
+        if (index_.is_open()) index_.close();
+        data_.clear();
+        index_.clear();
+    }
 
-        out << "bulk: ";
-        for (std::size_t i = 0; i < b.commands.size(); ++i) {
-            if (i) out << ", ";
-            out << b.commands[i];
+    const std::size_t max_segment_bytes_;
+    std::mutex mutex_;
+    std::vector<char> data_buffer_;
+    std::vector<char> index_buffer_;
+    std::ofstream data_;
+    std::ofstream index_;
+    std::size_t segment_offset_ = 0; // bytes written to the current segment
+    std::size_t segment_no_ = 0;
+};
+
+// Extra flush triggers for BlockBuilder on top of the static block size and closing braces.
+// A zero value disables the corresponding trigger.
+struct FlushPolicy {
+    std::chrono::milliseconds max_latency{0}; // static block: flush this long after its first command
+    std::size_t max_block_bytes = 0;          // static block: flush once its commands take this many bytes
+    std::size_t max_dynamic_commands = 0;     // dynamic block: commands kept in memory before spilling to disk
+    std::filesystem::path spill_dir = std::filesystem::temp_directory_path();
+};
+
+// Temporary file holding the oldest commands of a dynamic block that outgrew its in-memory limit.
+// Commands are stored one per line (they are input lines, so they never contain '\n').
+class SpillFile {
+public:
+    explicit SpillFile(std::filesystem::path dir) : dir_(std::move(dir)) {
+    }
+
+    SpillFile(const SpillFile &) = delete;
+    SpillFile &operator=(const SpillFile &) = delete;
+
+    ~SpillFile() { discard(); }
+
+    [[nodiscard]] std::size_t count() const noexcept { return count_; }
+
+    void append(const CommandList &commands) {
+        if (!out_.is_open()) {
+            static std::atomic<std::uint64_t> file_no{0};
+            path_ = dir_ / ("bulk_spill_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count())
+                            + "_" + std::to_string(file_no.fetch_add(1)) + ".tmp");
+            out_.open(path_, std::ios::out | std::ios::trunc);
+            if (!out_) throw std::runtime_error("could not create spill file " + path_.string());
         }
-        out << '\n';
-    };
+        for (const auto &c: commands) out_ << c << '\n';
+        if (!out_) throw std::runtime_error("could not write spill file " + path_.string());
+        count_ += commands.size();
+    }
+
+    // Appends all spilled commands (oldest first) to out and removes the file.
+    void read_back(CommandList &out) {
+        out_.close();
+        std::ifstream in(path_);
+        for (std::string line; std::getline(in, line);) out.push_back(line);
+        discard();
+    }
+
+    void discard() {
+        if (out_.is_open()) out_.close();
+        if (!path_.empty()) {
+            std::error_code ec;
+            std::filesystem::remove(path_, ec);
+            path_.clear();
+        }
+        count_ = 0;
+    }
+
+private:
+    std::filesystem::path dir_;
+    std::filesystem::path path_;
+    std::ofstream out_;
+    std::size_t count_ = 0;
 };
 
 // Class responsible for building a block - the
 class BlockBuilder {
 public:
-    explicit BlockBuilder(const std::size_t static_block_size)
-        : static_block_size_(static_block_size) {
+    using Clock = std::chrono::steady_clock;
+
+    explicit BlockBuilder(const std::size_t static_block_size, std::shared_ptr<CommandPool> pool = nullptr,
+                          FlushPolicy policy = {})
+        : static_block_size_(static_block_size), pool_(std::move(pool)), policy_(std::move(policy)),
+          spill_(policy_.spill_dir) {
     }
 
     /* Process one input line. Returns true if a block became ready
-     *  (i.e. the caller should forward it to the sinks). */
-    bool feed_line(const std::string &line, Block &output_block) {
+     *  (i.e. the caller should forward it to the sinks). The line is copied into
+     *  the block's arena, and the finished block takes over the builder's command storage. */
+    bool feed_line(const std::string_view line, Block &output_block) {
         // ---------- brace handling ----------
         if (line == "{") {
             if (brace_depth_ == 0) {
                 // entering outermost dynamic block
                 // Flush any pending static block before switching mode
                 if (mode_ == Mode::STATIC && !commands_.empty()) {
-                    output_block = {commands_, first_command_timestamp_};
-                    reset_current_block();
+                    take_current_block(output_block);
                     mode_ = Mode::DYNAMIC; // will be set again below
                     ++brace_depth_;
                     return true; // a static block is ready
@@ -90,8 +505,7 @@ public:
                 if (brace_depth_ == 0) {
                     // closing outermost dynamic block
                     if (!commands_.empty()) {
-                        output_block = {commands_, first_command_timestamp_};
-                        reset_current_block();
+                        take_current_block(output_block);
                         mode_ = Mode::STATIC;
                         return true; // dynamic block finished
                     }
@@ -107,37 +521,71 @@ public:
         // regular command
         if (!block_started_) {
             first_command_timestamp_ = std::time(nullptr); // timestamp of first command
+            first_command_time_ = Clock::now();
             block_started_ = true;
         }
         commands_.push_back(line);
 
         if (mode_ == Mode::STATIC) {
             ++static_block_command_count_;
-            if (static_block_command_count_ == static_block_size_) {
+            if (static_block_command_count_ == static_block_size_ ||
+                (policy_.max_block_bytes > 0 && commands_.bytes() >= policy_.max_block_bytes)) {
                 // static block is full
-                output_block = {commands_, first_command_timestamp_};
-                reset_current_block(); // prepare for next static block
+                take_current_block(output_block); // prepare for next static block
                 return true;
             }
         }
-        // In DYNAMIC mode we simply keep collecting
+        // In DYNAMIC mode we keep collecting; the oldest commands go to disk once the in-memory limit is hit
+        else if (policy_.max_dynamic_commands > 0 && commands_.size() >= policy_.max_dynamic_commands) {
+            spill_.append(commands_);
+            commands_.clear();
+        }
         return false;
     }
 
+    /** Time at which the pending static block has to be flushed by poll(), if max_latency is set
+     *  and a static block is being collected. */
+    [[nodiscard]] std::optional<Clock::time_point> deadline() const {
+        if (policy_.max_latency.count() == 0 || mode_ != Mode::STATIC || commands_.empty()) return std::nullopt;
+        return first_command_time_ + policy_.max_latency;
+    }
+
+    /** Flushes the pending static block if its deadline has passed. Returns true if a block was produced. */
+    bool poll(const Clock::time_point now, Block &output_block) {
+        const auto due = deadline();
+        if (!due || now < *due) return false;
+        take_current_block(output_block);
+        return true;
+    }
+
     /** Called when EOF is reached – flushes a possible trailing static
      *  block. Returns true if a block was produced. */
     bool finish(Block &output_block) {
         if (mode_ == Mode::STATIC && !commands_.empty()) {
-            output_block = {commands_, first_command_timestamp_};
-            reset_current_block();
+            take_current_block(output_block);
             return true;
         }
         // If we are still inside a dynamic block we discard it (spec requirement)
         return false;
     }
 
+    /** Crash recovery: hands out whatever is pending - including an unfinished dynamic block,
+     *  which finish() would discard - and returns to the initial state. Returns true if a block was produced. */
+    bool salvage(Block &output_block) {
+        const bool pending = !commands_.empty() || spill_.count() > 0;
+        if (pending) take_current_block(output_block);
+        else reset_current_block();
+        mode_ = Mode::STATIC;
+        brace_depth_ = 0;
+        return pending;
+    }
+
+    /** True when nothing is pending: no commands collected and not inside {}. */
+    [[nodiscard]] bool idle() const noexcept { return commands_.empty() && spill_.count() == 0 && brace_depth_ == 0; }
+
     void reset_current_block() {
         commands_.clear();
+        spill_.discard();
         first_command_timestamp_ = 0;
         block_started_ = false;
         static_block_command_count_ = 0;
@@ -146,11 +594,32 @@ public:
 private:
     enum class Mode { STATIC, DYNAMIC };
 
+    // Moves the current commands out into output_block (no string is copied) and starts
+    // a new block on a recycled list if a pool is attached.
+    void take_current_block(Block &output_block) {
+        if (spill_.count() > 0) {
+            // a spilled dynamic block: read the oldest commands back, then append the in-memory tail
+            CommandList all = pool_ ? pool_->acquire() : CommandList{};
+            spill_.read_back(all);
+            all.append(commands_);
+            output_block.commands = std::move(all);
+        } else {
+            output_block.commands = std::move(commands_);
+            commands_ = pool_ ? pool_->acquire() : CommandList{};
+        }
+        output_block.timestamp = first_command_timestamp_;
+        reset_current_block();
+    }
+
     const std::size_t static_block_size_; // N from the command line
     Mode mode_ = Mode::STATIC;
     int brace_depth_ = 0; // nesting level of {}
     std::size_t static_block_command_count_ = 0; // #commands collected in static mode
-    std::vector<std::string> commands_; // commands of the current block
+    CommandList commands_; // commands of the current block
     std::time_t first_command_timestamp_ = 0; // timestamp of first command
     bool block_started_ = false; // true after first real command
+    std::shared_ptr<CommandPool> pool_; // optional source of recycled command vectors
+    const FlushPolicy policy_;
+    Clock::time_point first_command_time_{}; // monotonic time of first command, for max_latency
+    SpillFile spill_; // oldest commands of an oversized dynamic block
 };
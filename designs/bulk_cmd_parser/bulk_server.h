@@ -0,0 +1,257 @@
+#pragma once
+#include <arpa/inet.h>
+#include <csignal>
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdexcept>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <unordered_map>
+#include "bulk.h"
+#include "line_reader.h"
+
+// Serves many producers at once over a Unix-domain or TCP socket (Linux, epoll based).
+//  - every connection sends commands line by line, exactly as on stdin;
+//  - lines outside {} of all connections go into one shared static block;
+//  - each connection has its own dynamic block: a "{ ... }" from one client is never mixed with
+//    commands of another one, and does not flush the shared static block;
+//  - a connection that disconnects inside a dynamic block discards it (as EOF does on stdin);
+//  - a connection that sends a line longer than MAX_LINE_BYTES is closed (its dynamic block is discarded);
+//  - SIGINT / SIGTERM stop the server, flushing the pending static block.
+// Everything runs on one thread, so the builders need no locking; finished blocks are passed
+// to the dispatch callback (which normally hands them to AsyncSinks).
+class BulkServer {
+public:
+    using Dispatch = std::function<void(Block &)>;
+
+    // longest accepted command line; buffering stops there for a client that never sends '\n'
+    static constexpr std::size_t MAX_LINE_BYTES = 1 << 20;
+
+    struct Endpoint {
+        std::string unix_path; // listen on this Unix socket if not empty...
+        int tcp_port = 0;      // ...otherwise on this TCP port (all interfaces)
+    };
+
+    BulkServer(const Endpoint &endpoint, const std::size_t static_block_size, std::shared_ptr<CommandPool> pool,
+               FlushPolicy policy, Dispatch dispatch)
+        : pool_(std::move(pool)), policy_(std::move(policy)), dispatch_(std::move(dispatch)),
+          shared_(static_block_size, pool_, policy_), unix_path_(endpoint.unix_path) {
+        epoll_fd_ = check(epoll_create1(EPOLL_CLOEXEC), "epoll_create1");
+        listen_fd_ = endpoint.unix_path.empty() ? open_tcp(endpoint.tcp_port) : open_unix(endpoint.unix_path);
+        watch(listen_fd_);
+
+        const sigset_t mask = block_stop_signals();
+        signal_fd_ = check(signalfd(-1, &mask, SFD_CLOEXEC | SFD_NONBLOCK), "signalfd");
+        watch(signal_fd_);
+    }
+
+    BulkServer(const BulkServer &) = delete;
+    BulkServer &operator=(const BulkServer &) = delete;
+
+    ~BulkServer() {
+        for (const auto &[fd, conn]: connections_) close(fd);
+        if (signal_fd_ >= 0) close(signal_fd_);
+        if (listen_fd_ >= 0) close(listen_fd_);
+        if (epoll_fd_ >= 0) close(epoll_fd_);
+        if (!unix_path_.empty()) unlink(unix_path_.c_str());
+    }
+
+    // Blocks SIGINT / SIGTERM in the calling thread so the server can receive them through a signalfd.
+    // Call it before starting any other thread (e.g. AsyncSink workers): threads inherit the mask,
+    // otherwise the kernel may deliver the signal to one of them and kill the process.
+    static sigset_t block_stop_signals() {
+        sigset_t mask;
+        sigemptyset(&mask);
+        sigaddset(&mask, SIGINT);
+        sigaddset(&mask, SIGTERM);
+        if (const int rc = pthread_sigmask(SIG_BLOCK, &mask, nullptr); rc != 0)
+            throw std::runtime_error(std::string("pthread_sigmask: ") + std::strerror(rc));
+        return mask;
+    }
+
+    // Serves connections until SIGINT / SIGTERM, then flushes the shared static block.
+    void run() {
+        epoll_event events[64];
+        while (!stopping_) {
+            const int n = epoll_wait(epoll_fd_, events, 64, timeout_ms());
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                throw std::runtime_error(std::string("epoll_wait: ") + std::strerror(errno));
+            }
+            for (int i = 0; i < n; ++i) {
+                const int fd = events[i].data.fd;
+                if (fd == listen_fd_) accept_all();
+                else if (fd == signal_fd_) stopping_ = true;
+                else on_readable(fd);
+            }
+            if (shared_.poll(BlockBuilder::Clock::now(), block_)) dispatch_(block_);
+        }
+        if (shared_.finish(block_)) dispatch_(block_);
+    }
+
+private:
+    struct Connection {
+        Connection(std::shared_ptr<CommandPool> pool, const FlushPolicy &policy)
+            : dynamic(std::numeric_limits<std::size_t>::max(), std::move(pool), policy) {
+        }
+
+        std::string pending; // received bytes after the last complete line
+        int depth = 0;       // nesting level of {} on this connection
+        BlockBuilder dynamic; // only ever fed lines inside {}, so it only produces dynamic blocks
+    };
+
+    static int check(const int rc, const char *what) {
+        if (rc < 0) throw std::runtime_error(std::string(what) + ": " + std::strerror(errno));
+        return rc;
+    }
+
+    static int open_unix(const std::string &path) {
+        sockaddr_un addr{};
+        if (path.size() >= sizeof(addr.sun_path)) throw std::runtime_error("socket path too long: " + path);
+        addr.sun_family = AF_UNIX;
+        std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+        // a stale socket from a previous run (nobody accepts on it any more) is replaced; a socket that
+        // a running server still listens on, or anything that is not a socket, is left alone
+        struct stat st{};
+        if (lstat(path.c_str(), &st) == 0) {
+            if (!S_ISSOCK(st.st_mode)) throw std::runtime_error("not a socket, refusing to replace: " + path);
+            if (!is_stale(addr)) throw std::runtime_error("address in use: " + path);
+            check(unlink(path.c_str()), "unlink");
+        } else if (errno != ENOENT) {
+            check(-1, "lstat");
+        }
+        const int fd = check(socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0), "socket");
+        check(bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)), "bind");
+        check(listen(fd, SOMAXCONN), "listen");
+        return fd;
+    }
+
+    // True if connecting to the Unix socket is refused: no process listens on it. Any other failure
+    // (e.g. a full backlog of a live server) is an error, so the path is never taken over by mistake.
+    static bool is_stale(const sockaddr_un &addr) {
+        const int fd = check(socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0), "socket");
+        const int rc = connect(fd, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr));
+        const int error = rc < 0 ? errno : 0;
+        close(fd);
+        if (rc == 0) return false;
+        if (error == ECONNREFUSED) return true;
+        throw std::runtime_error(std::string("connect to existing socket: ") + std::strerror(error));
+    }
+
+    static int open_tcp(const int port) {
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        addr.sin_port = htons(static_cast<std::uint16_t>(port));
+        const int fd = check(socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0), "socket");
+        const int yes = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+        check(bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)), "bind");
+        check(listen(fd, SOMAXCONN), "listen");
+        return fd;
+    }
+
+    void watch(const int fd) const {
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        check(epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev), "epoll_ctl");
+    }
+
+    // epoll timeout: until the shared static block's max-latency deadline, or forever
+    int timeout_ms() const {
+        const auto due = shared_.deadline();
+        if (!due) return -1;
+        const auto left = std::chrono::ceil<std::chrono::milliseconds>(*due - BlockBuilder::Clock::now());
+        return static_cast<int>(std::max<std::chrono::milliseconds::rep>(left.count(), 0));
+    }
+
+    void accept_all() {
+        for (;;) {
+            const int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                    std::cerr << "Error: accept: " << std::strerror(errno) << '\n';
+                return;
+            }
+            connections_.try_emplace(fd, pool_, policy_);
+            watch(fd);
+        }
+    }
+
+    void on_readable(const int fd) {
+        const auto it = connections_.find(fd);
+        if (it == connections_.end()) return;
+        Connection &conn = it->second;
+
+        char buf[64 * 1024];
+        for (;;) {
+            const ssize_t got = read(fd, buf, sizeof(buf));
+            if (got > 0) {
+                conn.pending.append(buf, static_cast<std::size_t>(got));
+                consume_lines(conn);
+                if (conn.pending.size() > MAX_LINE_BYTES) {
+                    std::cerr << "Error: line longer than " << MAX_LINE_BYTES << " bytes, closing the connection\n";
+                    close(fd);
+                    connections_.erase(it);
+                    return;
+                }
+                continue;
+            }
+            if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+            if (got < 0 && errno == EINTR) continue;
+            // EOF or error: a trailing line without '\n' still counts (as with std::getline),
+            // an unfinished dynamic block is dropped together with the connection
+            if (!conn.pending.empty()) feed(conn, conn.pending);
+            close(fd);
+            connections_.erase(it);
+            return;
+        }
+    }
+
+    void consume_lines(Connection &conn) {
+        const char *first = conn.pending.data();
+        const char *const last = first + conn.pending.size();
+        for (const char *nl; (nl = find_newline(first, last)) != last; first = nl + 1)
+            feed(conn, std::string_view(first, static_cast<std::size_t>(nl - first)));
+        conn.pending.erase(0, static_cast<std::size_t>(first - conn.pending.data()));
+    }
+
+    // Routes one line either into the connection's dynamic block or into the shared static block.
+    void feed(Connection &conn, const std::string_view line) {
+        if (line == "{") {
+            ++conn.depth;
+            if (conn.dynamic.feed_line(line, block_)) dispatch_(block_);
+            return;
+        }
+        if (line == "}") {
+            if (conn.depth == 0) return; // stray '}' is ignored
+            --conn.depth;
+            if (conn.dynamic.feed_line(line, block_)) dispatch_(block_);
+            return;
+        }
+        BlockBuilder &target = conn.depth > 0 ? conn.dynamic : shared_;
+        if (target.feed_line(line, block_)) dispatch_(block_);
+    }
+
+    std::shared_ptr<CommandPool> pool_;
+    const FlushPolicy policy_;
+    Dispatch dispatch_;
+    BlockBuilder shared_; // static block shared by all connections
+    Block block_;         // reused output slot; dispatch_ moves the block out of it
+    std::unordered_map<int, Connection> connections_;
+    std::string unix_path_;
+    int epoll_fd_ = -1;
+    int listen_fd_ = -1;
+    int signal_fd_ = -1;
+    bool stopping_ = false;
+};
@@ -0,0 +1,67 @@
+#pragma once
+#include <functional>
+#include <memory>
+#include <vector>
+#include "async_sink.h"
+#include "bulk.h"
+
+// Fans finished blocks out to any number of registered sinks.
+//  - each block is wrapped once into a shared immutable handle (SharedBlock) that every sink gets,
+//    so commands are never copied and the text form is formatted at most once for all text sinks;
+//  - sinks are registered at runtime instead of being listed in main; the dispatcher owns them.
+class BlockDispatcher {
+public:
+    explicit BlockDispatcher(std::shared_ptr<CommandPool> pool) : pool_(std::move(pool)) {
+    }
+
+    BlockDispatcher(const BlockDispatcher &) = delete;
+    BlockDispatcher &operator=(const BlockDispatcher &) = delete;
+
+    ~BlockDispatcher() { close(); }
+
+    // Registers a sink called directly on the dispatching thread.
+    IBlockSink &add_sink(std::unique_ptr<IBlockSink> sink) {
+        owned_.push_back(std::move(sink));
+        targets_.push_back(owned_.back().get());
+        return *owned_.back();
+    }
+
+    // Registers a sink that runs on its own worker threads behind a bounded queue (see AsyncSink).
+    IBlockSink &add_async_sink(std::unique_ptr<IBlockSink> sink, const std::size_t workers) {
+        owned_.push_back(std::move(sink));
+        async_.push_back(std::make_unique<AsyncSink>(*owned_.back(), workers));
+        targets_.push_back(async_.back().get());
+        return *owned_.back();
+    }
+
+    [[nodiscard]] std::size_t sink_count() const noexcept { return targets_.size(); }
+
+    // Moves the block into one shared handle and hands it to every sink.
+    // on_done, if set, is called (on whichever thread lets go last) once every sink is done with the block.
+    void dispatch(Block &b, std::function<void()> on_done = {}) {
+        if (targets_.empty()) {
+            if (on_done) on_done();
+            return;
+        }
+        BlockPtr shared = pool_ ? pool_->share(std::move(b)) : std::make_shared<const SharedBlock>(std::move(b));
+        if (on_done) {
+            const SharedBlock *raw = shared.get();
+            shared = BlockPtr(raw, [inner = std::move(shared), done = std::move(on_done)](const SharedBlock *) mutable {
+                inner.reset(); // the pooled block goes back first
+                done();
+            });
+        }
+        for (auto *sink: targets_) sink->consume_shared(shared);
+    }
+
+    // Waits until asynchronous sinks have written everything dispatched so far and stops their workers.
+    void close() {
+        for (auto &a: async_) a->close();
+    }
+
+private:
+    std::shared_ptr<CommandPool> pool_;
+    std::vector<std::unique_ptr<IBlockSink> > owned_; // registered sinks, in registration order
+    std::vector<std::unique_ptr<AsyncSink> > async_;  // queue + workers in front of async sinks
+    std::vector<IBlockSink *> targets_;              // what dispatch() calls
+};
@@ -0,0 +1,86 @@
+#pragma once
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+#include <vector>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Returns a pointer to the first '\n' in [first, last), or last if there is none.
+// With SSE2 16 bytes are compared per step; otherwise memchr (itself vectorised in most libcs).
+inline const char *find_newline(const char *first, const char *last) {
+#if defined(__SSE2__)
+    const __m128i nl = _mm_set1_epi8('\n');
+    for (; last - first >= 16; first += 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(first));
+        if (const int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, nl)); mask != 0)
+            return first + __builtin_ctz(static_cast<unsigned>(mask));
+    }
+#endif
+    const void *hit = std::memchr(first, '\n', static_cast<std::size_t>(last - first));
+    return hit ? static_cast<const char *>(hit) : last;
+}
+
+// Reads a file descriptor in large chunks and hands out its lines as string_views into the chunk
+// buffer, replacing std::getline (one virtual call and one string copy per line).
+// Same line semantics as std::getline: '\n' is stripped, a last line without '\n' is still returned.
+// A returned view stays valid until the next call to next().
+class LineReader {
+public:
+    explicit LineReader(const int fd, const std::size_t chunk_size = 1 << 20)
+        : fd_(fd), buffer_(chunk_size) {
+    }
+
+    bool next(std::string_view &line) {
+        for (;;) {
+            const char *first = buffer_.data() + begin_;
+            const char *last = buffer_.data() + end_;
+            const char *nl = find_newline(first, last);
+            if (nl != last) {
+                line = {first, static_cast<std::size_t>(nl - first)};
+                begin_ += line.size() + 1;
+                return true;
+            }
+            if (eof_) {
+                if (begin_ == end_) return false;
+                line = {first, end_ - begin_}; // last line without '\n'
+                begin_ = end_;
+                return true;
+            }
+            refill();
+        }
+    }
+
+private:
+    // Moves the unfinished line to the front (growing the buffer for very long lines) and reads more.
+    void refill() {
+        if (begin_ > 0) {
+            std::memmove(buffer_.data(), buffer_.data() + begin_, end_ - begin_);
+            end_ -= begin_;
+            begin_ = 0;
+        }
+        if (end_ == buffer_.size()) buffer_.resize(buffer_.size() * 2);
+        for (;;) {
+            const ssize_t got = read(fd_, buffer_.data() + end_, buffer_.size() - end_);
+            if (got > 0) {
+                end_ += static_cast<std::size_t>(got);
+                return;
+            }
+            if (got == 0) {
+                eof_ = true;
+                return;
+            }
+            if (errno != EINTR) throw std::runtime_error(std::string("read: ") + std::strerror(errno));
+        }
+    }
+
+    const int fd_;
+    std::vector<char> buffer_;
+    std::size_t begin_ = 0; // first unread byte
+    std::size_t end_ = 0;   // end of valid data
+    bool eof_ = false;
+};
@@ -1,13 +1,95 @@
 #include "bulk.h"
+#include "binary_sinks.h"
+#include "bulk_server.h"
+#include "dispatcher.h"
+#include "line_reader.h"
+#include "wal.h"
+#include <condition_variable>
 #include <iostream>
+#include <latch>
+#include <mutex>
+#include <string>
+#include <thread>
 #include <vector>
 #include <memory>
 
+namespace {
+    constexpr auto usage =
+            " <block-size> [--file-workers <n>] [--log-format <text|binary|compressed>] [--segment-size <bytes>]"
+            " [--max-latency-ms <ms>] [--max-block-bytes <bytes>]"
+            " [--max-dynamic-commands <n>] [--spill-dir <dir>]"
+            " [--listen-unix <path> | --listen-tcp <port>]"
+            " [--wal <path>] [--wal-sync-ms <ms>]\n";
+
+    struct Options {
+        std::size_t block_size = 0;
+        // number of threads writing per-block log files; console output and the ordered logs (binary,
+        // compressed, text segments) always have a single worker to keep order
+        std::size_t file_workers = 2;
+        // text - human readable logs; binary - length-prefixed segment files; compressed - one compressed stream
+        std::string log_format = "text";
+        // text: 0 - one log file per block; otherwise blocks are appended to rotating segment files of this size
+        // binary: segment size (0 - default)
+        std::size_t segment_size = 0;
+        FlushPolicy flush;
+        // server mode: read commands from socket connections instead of stdin
+        BulkServer::Endpoint listen;
+        // write-ahead log of the input for crash recovery (empty - off) and its group-commit interval
+        std::string wal_path;
+        std::chrono::milliseconds wal_sync{10};
+    };
+
+    // parses a strictly positive integer command-line value; returns 0 on error
+    std::size_t parse_positive(const char *arg) {
+        long long tmp = 0;
+        try { tmp = std::stoll(arg); }
+        catch (...) { return 0; }
+        return tmp > 0 ? static_cast<std::size_t>(tmp) : 0;
+    }
+
+    // options come in "--name value" pairs after the block size; returns false on any error
+    bool parse_options(const int argc, char *argv[], Options &opt) {
+        for (int i = 2; i < argc; i += 2) {
+            if (i + 1 >= argc) return false;
+            const std::string option = argv[i];
+            if (option == "--spill-dir") {
+                opt.flush.spill_dir = argv[i + 1];
+                continue;
+            }
+            if (option == "--log-format") {
+                opt.log_format = argv[i + 1];
+                if (opt.log_format != "text" && opt.log_format != "binary" && opt.log_format != "compressed")
+                    return false;
+                continue;
+            }
+            if (option == "--listen-unix") {
+                opt.listen.unix_path = argv[i + 1];
+                continue;
+            }
+            if (option == "--wal") {
+                opt.wal_path = argv[i + 1];
+                continue;
+            }
+            const std::size_t value = parse_positive(argv[i + 1]);
+            if (value == 0) return false;
+            if (option == "--file-workers") opt.file_workers = value;
+            else if (option == "--segment-size") opt.segment_size = value;
+            else if (option == "--max-latency-ms") opt.flush.max_latency = std::chrono::milliseconds(value);
+            else if (option == "--max-block-bytes") opt.flush.max_block_bytes = value;
+            else if (option == "--max-dynamic-commands") opt.flush.max_dynamic_commands = value;
+            else if (option == "--listen-tcp" && value <= 65535) opt.listen.tcp_port = static_cast<int>(value);
+            else if (option == "--wal-sync-ms") opt.wal_sync = std::chrono::milliseconds(value);
+            else return false;
+        }
+        return true;
+    }
+}
+
 int main(const int argc, char* argv[])
 {
     // handling static block size argument edge cases
-    if (argc != 2) {
-        std::cerr << "Usage: " << argv[0] << " <block-size>\n";
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << usage;
         return 1;
     }
 
@@ -21,27 +103,142 @@ int main(const int argc, char* argv[])
         std::cerr << "Block size must be a positive integer.\n";
         return 1;
     }
-    const auto block_size = static_cast<std::size_t>(tmp);
+
+    Options opt;
+    opt.block_size = static_cast<std::size_t>(tmp);
+    if (!parse_options(argc, argv, opt)) {
+        std::cerr << "Usage: " << argv[0] << usage;
+        return 1;
+    }
+
+    const bool server_mode = !opt.listen.unix_path.empty() || opt.listen.tcp_port != 0;
+    // the WAL needs "block is written" to mean the log file is complete on disk: only the per-block
+    // text files give that; buffered segment / binary / compressed sinks would acknowledge too early.
+    // Server mode interleaves many clients, which a single replayed input stream cannot represent.
+    if (!opt.wal_path.empty() && (server_mode || opt.log_format != "text" || opt.segment_size > 0)) {
+        std::cerr << "--wal works only with stdin input and --log-format text without --segment-size\n";
+        return 1;
+    }
+    if (server_mode) BulkServer::block_stop_signals(); // before any worker thread exists
 
     // main functionality
-    BlockBuilder builder(block_size);
-    ConsoleSink console_sink;
-    FileSink    file_sink;
+    // BlockBuilder runs on this (input) thread; finished blocks are handed to the sinks
+    // through bounded queues, so a slow disk never stalls reading of the input.
+    // Blocks are moved (never copied) from the builder into one shared handle per block that every
+    // sink receives; their command lists come back through the pool once all sinks are done.
+    const auto pool = CommandPool::create();
+    BlockBuilder builder(opt.block_size, pool, opt.flush);
 
-    const std::vector<IBlockSink*> sinks = { &console_sink, &file_sink };
+    BlockDispatcher dispatcher(pool);
+    dispatcher.add_async_sink(std::make_unique<ConsoleSink>(), 1);
+    // binary and compressed logs are ordered streams that replay reads back in file order: a single
+    // worker keeps blocks in the order they were built (more workers would only race for the sink's lock)
+    if (opt.log_format == "binary")
+        dispatcher.add_async_sink(std::make_unique<BinarySegmentSink>(opt.segment_size > 0 ? opt.segment_size : 64 << 20),
+                                  1);
+    else if (opt.log_format == "compressed")
+        dispatcher.add_async_sink(std::make_unique<CompressedSink>(), 1);
+    else if (opt.segment_size > 0)
+        dispatcher.add_async_sink(std::make_unique<SegmentFileSink>(opt.segment_size), 1); // ordered append log
+    else if (opt.wal_path.empty())
+        dispatcher.add_async_sink(std::make_unique<FileSink>(), opt.file_workers);
+    else // the WAL may only drop a block once its log file is on disk
+        dispatcher.add_async_sink(std::make_unique<FileSink>(opt.wal_sync), opt.file_workers);
 
-    std::string line;
-    while (std::getline(std::cin, line)) {
-        Block output_block;
-        if (builder.feed_line(line, output_block)) {
-            for (auto* s : sinks) s->consume(output_block);
+    if (server_mode) {
+        try {
+            BulkServer server(opt.listen, opt.block_size, pool, opt.flush, [&](Block &b) { dispatcher.dispatch(b); });
+            server.run();
+        } catch (const std::exception &e) {
+            std::cerr << "Error: " << e.what() << '\n';
+            return 1;
         }
+        dispatcher.close();
+        return 0;
     }
 
-    Block final_block;
-    if (builder.finish(final_block)) {
-        for (auto* s : sinks) s->consume(final_block);
+    // With --wal every input line is logged before it is fed, and each block is marked done once
+    // all sinks wrote it. Blocks left over by a crashed run are rebuilt from the log and written
+    // first, cut with the block settings recorded in the log; only then is the log emptied for this run.
+    std::unique_ptr<WriteAheadLog> wal;
+    if (!opt.wal_path.empty()) {
+        try {
+            auto recovered = WriteAheadLog::recover(opt.wal_path, opt.flush);
+            std::latch recovered_written(static_cast<std::ptrdiff_t>(recovered.size()));
+            for (auto &b: recovered) dispatcher.dispatch(b, [&] { recovered_written.count_down(); });
+            recovered_written.wait();
+            wal = std::make_unique<WriteAheadLog>(opt.wal_path, opt.block_size, opt.flush, opt.wal_sync);
+            wal->compact();
+        } catch (const std::exception &e) {
+            std::cerr << "Error: " << e.what() << '\n';
+            return 1;
+        }
+    }
+
+    Block output_block;
+    auto dispatch = [&] {
+        if (!wal) return dispatcher.dispatch(output_block);
+        dispatcher.dispatch(output_block, [&wal, ordinal = wal->block_dispatched()] { wal->block_done(ordinal); });
+        // once the log is large and nothing in it is needed any more, start it over
+        if (builder.idle() && wal->should_compact()) {
+            wal->wait_idle();
+            wal->compact();
+        }
+    };
+
+    // With --max-latency-ms a timer thread flushes a static block that waited too long for more
+    // input; it shares the builder with the input thread, so both take builder_mutex.
+    // Without it the input thread owns the builder and no locking happens.
+    const bool timed = opt.flush.max_latency.count() > 0;
+    std::mutex builder_mutex;
+    std::condition_variable deadline_changed;
+    bool input_done = false;
+    std::thread flusher;
+    if (timed) {
+        flusher = std::thread([&] {
+            std::unique_lock lock(builder_mutex);
+            while (!input_done) {
+                if (const auto due = builder.deadline()) deadline_changed.wait_until(lock, *due);
+                else deadline_changed.wait(lock);
+                if (!input_done && builder.poll(BlockBuilder::Clock::now(), output_block)) {
+                    if (wal) wal->log_timer_flush();
+                    dispatch();
+                }
+            }
+        });
+    }
+
+    // stdin is read in large chunks; lines are views into the chunk, copied once into the block's arena
+    LineReader reader(STDIN_FILENO);
+    std::string_view line;
+    while (reader.next(line)) {
+        std::unique_lock lock(builder_mutex, std::defer_lock);
+        if (timed) lock.lock();
+        const bool had_deadline = builder.deadline().has_value();
+        if (wal) wal->log_line(line);
+        if (builder.feed_line(line, output_block)) dispatch();
+        // wake the timer only when a new static block started, not for every line
+        if (timed && !had_deadline && builder.deadline()) deadline_changed.notify_one();
+    }
+
+    if (timed) {
+        {
+            std::lock_guard lock(builder_mutex);
+            input_done = true;
+        }
+        deadline_changed.notify_one();
+        flusher.join();
+    }
+
+    if (builder.finish(output_block)) dispatch();
+
+    // drain: every queued block is written before the process exits
+    dispatcher.close();
+    // a clean shutdown leaves nothing to recover (once the last file renames are synced)
+    if (wal) {
+        wal->wait_idle();
+        wal->compact();
     }
 
     return 0;
-}
\ No newline at end of file
+}
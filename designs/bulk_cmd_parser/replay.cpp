@@ -0,0 +1,68 @@
+// bulk_replay - prints the blocks stored in binary (.bin) or compressed (.bcz) bulk logs
+// in the same "bulk: a, b, c" form the console sink uses.
+#include "block_codec.h"
+#include "binary_sinks.h"
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+
+namespace {
+    // Prints all complete records of an uncompressed record stream; returns the number of bytes used.
+    std::size_t replay_records(const std::string_view data) {
+        Block b;
+        std::size_t pos = 0;
+        while (block_codec::read_record(data, pos, b)) std::cout << format_block(b);
+        return pos;
+    }
+
+    void replay_file(const std::string &path) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) throw std::runtime_error("could not open " + path);
+        const std::string data{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+        const std::string_view view = data;
+
+        if (view.starts_with(BINARY_MAGIC)) {
+            const auto body = view.substr(BINARY_MAGIC.size());
+            // a truncated last record (e.g. after a crash) is reported, everything before it is kept
+            if (replay_records(body) != body.size())
+                std::cerr << path << ": truncated record at the end ignored\n";
+            return;
+        }
+
+        if (view.starts_with(COMPRESSED_MAGIC) && view.size() > COMPRESSED_MAGIC.size()) {
+            const auto codec = static_cast<block_codec::Codec>(view[COMPRESSED_MAGIC.size()]);
+            std::size_t pos = COMPRESSED_MAGIC.size() + 1;
+            const auto *p = reinterpret_cast<const unsigned char *>(view.data());
+            std::string raw;
+            while (view.size() - pos >= 8) {
+                const std::uint32_t raw_size = block_codec::get_u32(p + pos);
+                const std::uint32_t packed_size = block_codec::get_u32(p + pos + 4);
+                pos += 8;
+                if (view.size() - pos < packed_size) break;
+                raw.clear();
+                block_codec::decompress(codec, view.substr(pos, packed_size), raw, raw_size);
+                replay_records(raw);
+                pos += packed_size;
+            }
+            if (pos != view.size()) std::cerr << path << ": truncated frame at the end ignored\n";
+            return;
+        }
+
+        throw std::runtime_error(path + " is not a binary bulk log");
+    }
+}
+
+int main(const int argc, char *argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <file.bin|file.bcz>...\n";
+        return 1;
+    }
+    try {
+        for (int i = 1; i < argc; ++i) replay_file(argv[i]);
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << '\n';
+        return 1;
+    }
+    return 0;
+}
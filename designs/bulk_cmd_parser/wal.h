@@ -0,0 +1,217 @@
+#pragma once
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unistd.h>
+#include <unordered_set>
+#include <vector>
+#include "bulk.h"
+
+// Append-only write-ahead log for bulk, so blocks survive a crash of the process.
+//
+// Records (one per line):
+//     h <block size> <max block bytes> <max latency ms> - header, first record: the settings that
+//                      decide where blocks end, so recovery cuts the same blocks as the crashed run
+//     l <input line>   - an input line, logged before it is fed to BlockBuilder
+//     f                - BlockBuilder flushed its static block on the max-latency timer
+//     d <ordinal>      - every sink is done with the block dispatched as number <ordinal>
+//
+// Appending only copies into memory; a writer thread commits everything gathered so far with one
+// write() + fdatasync() every sync_interval (group commit), so the fsync cost is shared by all
+// commands of that interval. After a crash recover() replays the input lines through a fresh
+// BlockBuilder: blocks without a "d" record are produced again, and the block that was still being
+// collected (static or dynamic) is salvaged instead of being discarded.
+// Once nothing is pending the log is truncated (compact()), so it only ever holds the tail of the input.
+class WriteAheadLog {
+public:
+    WriteAheadLog(const std::string &path, const std::size_t static_block_size, const FlushPolicy &policy,
+                  const std::chrono::milliseconds sync_interval, const std::size_t compact_bytes = 64 << 20)
+        : header_("h " + std::to_string(static_block_size) + ' ' + std::to_string(policy.max_block_bytes) + ' ' +
+                  std::to_string(policy.max_latency.count()) + '\n'),
+          sync_interval_(sync_interval), compact_bytes_(compact_bytes) {
+        fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd_ < 0) throw std::runtime_error("could not open WAL " + path + ": " + std::strerror(errno));
+        if (::lseek(fd_, 0, SEEK_END) == 0) buffer_ = header_;
+        writer_ = std::thread([this] { run(); });
+    }
+
+    WriteAheadLog(const WriteAheadLog &) = delete;
+    WriteAheadLog &operator=(const WriteAheadLog &) = delete;
+
+    ~WriteAheadLog() {
+        {
+            std::lock_guard lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_one();
+        writer_.join();
+        ::close(fd_);
+    }
+
+    // Rebuilds the blocks that did not reach the sinks before a crash. An empty or missing log yields nothing.
+    // Block size, max block bytes and max latency are taken from the log header, not from the current
+    // run; only the spill settings of policy are used. A log without a valid header is refused.
+    static std::vector<Block> recover(const std::string &path, FlushPolicy policy) {
+        std::vector<Block> out;
+        std::ifstream in(path, std::ios::binary);
+        if (!in) return out;
+
+        std::vector<std::string> records;
+        std::unordered_set<std::uint64_t> done;
+        std::string data{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+        // a record without its '\n' was cut by the crash and never committed - drop it
+        data.erase(data.rfind('\n') == std::string::npos ? 0 : data.rfind('\n') + 1);
+        std::string_view rest = data;
+        if (rest.empty()) return out;
+
+        std::size_t static_block_size = 0;
+        {
+            std::istringstream header(std::string(rest.substr(0, rest.find('\n'))));
+            std::string tag;
+            long long latency_ms = -1;
+            header >> tag >> static_block_size >> policy.max_block_bytes >> latency_ms;
+            if (!header || tag != "h" || static_block_size == 0 || latency_ms < 0)
+                throw std::runtime_error("WAL " + path + " has no valid header, refusing to recover from it");
+            policy.max_latency = std::chrono::milliseconds(latency_ms);
+            rest.remove_prefix(rest.find('\n') + 1);
+        }
+        for (std::size_t nl; (nl = rest.find('\n')) != std::string_view::npos; rest.remove_prefix(nl + 1)) {
+            const std::string_view rec = rest.substr(0, nl);
+            if (rec.starts_with("d ")) done.insert(std::stoull(std::string(rec.substr(2))));
+            else records.emplace_back(rec);
+        }
+
+        // "f" records replay timer flushes: any non-zero latency makes poll() flush on request
+        if (policy.max_latency.count() > 0) policy.max_latency = std::chrono::milliseconds(1);
+        BlockBuilder replay(static_block_size, nullptr, policy);
+        Block block;
+        std::uint64_t ordinal = 0;
+        auto produced = [&] {
+            if (!done.contains(ordinal++)) out.push_back(std::move(block));
+            block = Block{};
+        };
+        for (const auto &rec: records) {
+            if (rec.starts_with("l ")) {
+                if (replay.feed_line(std::string_view(rec).substr(2), block)) produced();
+            } else if (rec == "f") {
+                if (replay.poll(BlockBuilder::Clock::time_point::max(), block)) produced();
+            }
+        }
+        if (replay.salvage(block)) out.push_back(std::move(block));
+        return out;
+    }
+
+    void log_line(const std::string_view line) {
+        std::lock_guard lock(mutex_);
+        buffer_ += "l ";
+        buffer_ += line;
+        buffer_ += '\n';
+        bytes_ += line.size() + 3;
+    }
+
+    void log_timer_flush() {
+        std::lock_guard lock(mutex_);
+        buffer_ += "f\n";
+        bytes_ += 2;
+    }
+
+    // Call right before dispatching a block; returns its ordinal for block_done().
+    std::uint64_t block_dispatched() {
+        std::lock_guard lock(mutex_);
+        ++outstanding_;
+        return next_ordinal_++;
+    }
+
+    // Called (from any thread) once every sink is done with the block.
+    void block_done(const std::uint64_t ordinal) {
+        {
+            std::lock_guard lock(mutex_);
+            buffer_ += "d " + std::to_string(ordinal) + '\n';
+            --outstanding_;
+        }
+        idle_.notify_all();
+    }
+
+    // Blocks until every dispatched block is done.
+    void wait_idle() {
+        std::unique_lock lock(mutex_);
+        idle_.wait(lock, [this] { return outstanding_ == 0; });
+    }
+
+    // True when the log has grown past compact_bytes and should be truncated.
+    [[nodiscard]] bool should_compact() const {
+        std::lock_guard lock(mutex_);
+        return bytes_ >= compact_bytes_;
+    }
+
+    // Truncates the log, leaving only the header. Only valid when BlockBuilder is idle and (after wait_idle()) no block is in flight:
+    // then nothing in the log is needed for recovery any more.
+    void compact() {
+        std::lock_guard committing(commit_mutex_); // a batch taken before the truncation must not land after it
+        std::lock_guard lock(mutex_);
+        buffer_ = header_;
+        if (::ftruncate(fd_, 0) != 0) std::cerr << "Error: WAL truncate: " << std::strerror(errno) << '\n';
+        bytes_ = 0;
+        next_ordinal_ = 0;
+    }
+
+private:
+    void run() {
+        std::string batch;
+        for (bool last = false; !last;) {
+            {
+                std::unique_lock lock(mutex_);
+                wake_.wait_for(lock, sync_interval_, [this] { return stopping_; });
+            }
+            std::lock_guard committing(commit_mutex_);
+            {
+                std::lock_guard lock(mutex_);
+                batch.swap(buffer_);
+                last = stopping_;
+            }
+            commit(batch);
+            batch.clear();
+        }
+    }
+
+    // One write and one fdatasync for everything appended since the previous commit.
+    void commit(const std::string &batch) const {
+        if (batch.empty()) return;
+        std::size_t off = 0;
+        while (off < batch.size()) {
+            const ssize_t n = ::write(fd_, batch.data() + off, batch.size() - off);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                std::cerr << "Error: WAL write: " << std::strerror(errno) << '\n';
+                return;
+            }
+            off += static_cast<std::size_t>(n);
+        }
+        if (::fdatasync(fd_) != 0) std::cerr << "Error: WAL fdatasync: " << std::strerror(errno) << '\n';
+    }
+
+    const std::string header_;
+    const std::chrono::milliseconds sync_interval_;
+    const std::size_t compact_bytes_;
+    int fd_ = -1;
+    std::mutex commit_mutex_;       // held while a batch is written; taken before mutex_
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    std::string buffer_;            // records not yet committed
+    std::size_t bytes_ = 0;         // input bytes logged since the last compaction
+    std::uint64_t next_ordinal_ = 0;
+    std::uint64_t outstanding_ = 0; // dispatched blocks not done yet
+    bool stopping_ = false;
+    std::thread writer_;
+};
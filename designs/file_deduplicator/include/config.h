@@ -14,6 +14,7 @@ namespace bayan {
         std::vector<std::string> masks; // case‑insensitive regex patterns
         std::size_t block_size = 4096; // default block size
         HashAlgo hash_algo = HashAlgo::CRC32;
+        std::size_t threads = 0; // 0 → std::thread::hardware_concurrency()
     };
 
     /// Parses command line arguments with Boost.Program_options and fills a Config.
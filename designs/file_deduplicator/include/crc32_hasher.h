@@ -19,6 +19,11 @@ namespace bayan {
             return oss.str();
         }
 
+        std::string raw_digest() const override {
+            const auto value = static_cast<std::uint32_t>(crc.checksum());
+            return {reinterpret_cast<const char *>(&value), sizeof(value)};
+        }
+
         void reset() override { crc.reset(); }
 
     private:
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace bayan {
+    /**
+     * Digest → file-index table split into independently locked shards.
+     *
+     *   • insert() may be called concurrently from many workers; a shard is chosen
+     *     from the digest, so threads only contend when they hit the same shard.
+     *   • Keys are raw (binary) digests, values are indices into the caller's file list.
+     */
+    class ShardedDigestTable {
+    public:
+        explicit ShardedDigestTable(std::size_t shard_count);
+
+        /** Records that the file with the given index produced the given digest. */
+        void insert(std::string digest, std::size_t file_index);
+
+        /**
+         * Moves out every group holding at least min_size indices.
+         * Indices inside a group are sorted, groups are ordered by their first index,
+         * so the result does not depend on the order in which workers inserted.
+         */
+        std::vector<std::vector<std::size_t> > extract_groups(std::size_t min_size);
+
+    private:
+        struct Shard {
+            std::mutex mtx;
+            std::unordered_map<std::string, std::vector<std::size_t> > groups;
+        };
+
+        Shard &shard_for(const std::string &digest);
+
+        std::vector<Shard> shards_;
+    };
+}
@@ -32,6 +32,16 @@ namespace bayan {
             const std::vector<boost::filesystem::path> &files,
             std::vector<std::vector<boost::filesystem::path> > &out_groups) const;
 
+        /** Hashes block #block_index of every file in the bucket and splits it by digest. */
+        std::vector<std::vector<boost::filesystem::path> > rebucket(
+            const std::vector<boost::filesystem::path> &bucket, std::size_t block_index) const;
+
+        /** Returns the raw digest of block #block_index of a file (zero block past EOF). */
+        std::string block_digest(const boost::filesystem::path &p, std::size_t block_index) const;
+
+        /** Number of workers used by rebucket(); resolved from Config::threads. */
+        std::size_t worker_count() const;
+
         const Config cfg_;
 
         /** All files that survive the initial filtering, grouped by file size. */
@@ -15,6 +15,9 @@ namespace bayan {
         /// Return the hash of the data fed so far as a printable string.
         [[nodiscard]] virtual std::string digest() const = 0;
 
+        /// Return the hash as raw bytes (no hex encoding) – a compact key for hash tables.
+        [[nodiscard]] virtual std::string raw_digest() const = 0;
+
         /// Reset the internal state so the same object can be reused for another block.
         virtual void reset() = 0;
     };
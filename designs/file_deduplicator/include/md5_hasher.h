@@ -28,6 +28,13 @@ namespace bayan {
             return oss.str();
         }
 
+        [[nodiscard]] std::string raw_digest() const override {
+            auto tmp = ctx;
+            boost::uuids::detail::md5::digest_type d;
+            tmp.get_digest(d);
+            return {reinterpret_cast<const char *>(&d), sizeof(d)};
+        }
+
         void reset() override {
             ctx = boost::uuids::detail::md5();
         }
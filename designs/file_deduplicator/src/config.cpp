@@ -35,7 +35,8 @@ Config bayan::parse_config(const int argc, char *argv[]) {
             ("min-size", po::value<std::uintmax_t>(), "Minimal file size in bytes (default 2)")
             ("mask", po::value<std::vector<std::string> >()->multitoken(), "Case‑insensitive glob mask for filenames")
             ("block-size", po::value<std::size_t>(), "Size of a block (bytes) used for hashing")
-            ("hash", po::value<std::string>(), "Hash algorithm: crc32 or md5");
+            ("hash", po::value<std::string>(), "Hash algorithm: crc32 or md5")
+            ("threads", po::value<std::size_t>(), "Worker threads for hashing large size groups (0 = all cores)");
 
     po::variables_map vm;
     po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
@@ -60,6 +61,8 @@ Config bayan::parse_config(const int argc, char *argv[]) {
 
     if (vm.count("block-size")) cfg.block_size = vm["block-size"].as<std::size_t>();
 
+    if (vm.count("threads")) cfg.threads = vm["threads"].as<std::size_t>();
+
     if (vm.count("hash")) {
         HashAlgo ha;
         if (!to_hash_algo(vm["hash"].as<std::string>(), ha)) {
@@ -0,0 +1,35 @@
+#include "../include/digest_table.h"
+#include <algorithm>
+#include <functional>
+
+namespace bayan {
+    ShardedDigestTable::ShardedDigestTable(const std::size_t shard_count)
+        : shards_(std::max<std::size_t>(shard_count, 1)) {
+    }
+
+    ShardedDigestTable::Shard &ShardedDigestTable::shard_for(const std::string &digest) {
+        return shards_[std::hash<std::string>{}(digest) % shards_.size()];
+    }
+
+    void ShardedDigestTable::insert(std::string digest, const std::size_t file_index) {
+        Shard &shard = shard_for(digest);
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        shard.groups[std::move(digest)].push_back(file_index);
+    }
+
+    std::vector<std::vector<std::size_t> > ShardedDigestTable::extract_groups(const std::size_t min_size) {
+        std::vector<std::vector<std::size_t> > out;
+        for (auto &shard: shards_) {
+            std::lock_guard<std::mutex> lock(shard.mtx);
+            for (auto &[digest, indices]: shard.groups) {
+                if (indices.size() < min_size) continue;
+                std::sort(indices.begin(), indices.end());
+                out.push_back(std::move(indices));
+            }
+            shard.groups.clear();
+        }
+        std::sort(out.begin(), out.end(),
+                  [](const auto &a, const auto &b) { return a.front() < b.front(); });
+        return out;
+    }
+}
@@ -1,13 +1,26 @@
 #include "../include/duplicate_finder.h"
 #include <boost/regex.hpp>
 #include <fnmatch.h>
+#include "../include/digest_table.h"
+#include <algorithm>
+#include <exception>
 #include <iostream>
 #include <queue>
+#include <thread>
 #include <utility>
 
 namespace bfs = boost::filesystem;
 using namespace bayan;
 
+namespace {
+    // Buckets smaller than this are hashed on the calling thread – spawning workers
+    // costs more than opening a handful of files.
+    constexpr std::size_t PARALLEL_BUCKET_THRESHOLD = 256;
+
+    // Shards per worker: enough that two workers rarely pick the same shard.
+    constexpr std::size_t SHARDS_PER_WORKER = 8;
+} // anonymous
+
 DuplicateFinder::DuplicateFinder(Config cfg) : cfg_(std::move(cfg)) {
 }
 
@@ -138,9 +151,6 @@ void DuplicateFinder::process_size_group(
     // Start with a single bucket that holds every candidate of this size.
     std::vector<Bucket> active_buckets{files};
 
-    // Helper that creates a fresh hasher of the requested algorithm.
-    auto make_hasher_instance = [&]() { return make_hasher(cfg_.hash_algo); };
-
     std::size_t block_index = 0; // which block we are currently comparing
     bool any_bucket_active = true; // loop guard
 
@@ -152,53 +162,12 @@ void DuplicateFinder::process_size_group(
             if (bucket.size() < 2) continue; // nothing to compare here
 
             // -----------------------------------------------------------------
-            // STEP 1. Open a BlockReader for every file in the bucket.
-            // We advance each reader to the *current* block_index.
+            // STEP 1-3. Hash the current block of every file and group by digest
+            // (see rebucket()). STEP 4. Every group that still has ≥2 files survives.
             // -----------------------------------------------------------------
-            std::unordered_map<std::string, Bucket> hash_map; // hash → files
-
-            for (const bfs::path &p: bucket) {
-                BlockReader br(p, cfg_.block_size);
-
-                // Fast‑forward to the block we need.
-                // Because we know that we never read a block twice,
-                // we can simply call `next()` block_index times.
-                for (std::size_t i = 0; i < block_index; ++i) {
-                    if (!br.has_next()) break; // safety – should not happen for equal‑size files
-                    br.next(); // discard previous blocks
-                }
-
-                // If the file ended before we reach the desired block,
-                // it means the file length is a multiple of block_size and we are
-                // already at EOF. In that case the block is all zeros.
-                std::vector<unsigned char> blk;
-                if (br.has_next())
-                    blk = br.next(); // real data (maybe padded)
-                else
-                    blk.assign(cfg_.block_size, 0); // zero‑filled block
-
-                // -------------------------------------------------------------
-                // STEP 2. Compute the hash of the block.
-                // -------------------------------------------------------------
-                auto hasher = make_hasher_instance();
-                hasher->update(blk.data(), blk.size());
-                std::string dig = hasher->digest();
-
-                // -------------------------------------------------------------
-                // STEP 3. Put the file into the bucket identified by that hash.
-                // -------------------------------------------------------------
-                hash_map[dig].push_back(p);
-            }
-
-            // -------------------------------------------------------------
-            // STEP 4. Re‑bucket: every hash that still has ≥2 files survives.
-            // -------------------------------------------------------------
-            for (auto &[hash_value, file_path]: hash_map) {
-                if (file_path.size() >= 2) {
-                    next_round.push_back(std::move(file_path));
-                    any_bucket_active = true; // we have work for the next block
-                }
-                // Singletons are dropped – they cannot be duplicates.
+            for (auto &survivor: rebucket(bucket, block_index)) {
+                next_round.push_back(std::move(survivor));
+                any_bucket_active = true; // we have work for the next block
             }
         }
 
@@ -237,3 +206,91 @@ void DuplicateFinder::process_size_group(
         ++block_index; // advance to the next block for the following pass
     }
 }
+
+/* --------------------------------------------------------------------- */
+/* Hash one block of a file                                              */
+std::string DuplicateFinder::block_digest(const bfs::path &p, const std::size_t block_index) const {
+    BlockReader br(p, cfg_.block_size);
+
+    // Fast‑forward to the block we need.
+    // Because we know that we never read a block twice,
+    // we can simply call `next()` block_index times.
+    for (std::size_t i = 0; i < block_index; ++i) {
+        if (!br.has_next()) break; // safety – should not happen for equal‑size files
+        br.next(); // discard previous blocks
+    }
+
+    // If the file ended before we reach the desired block,
+    // it means the file length is a multiple of block_size and we are
+    // already at EOF. In that case the block is all zeros.
+    std::vector<unsigned char> blk;
+    if (br.has_next())
+        blk = br.next(); // real data (maybe padded)
+    else
+        blk.assign(cfg_.block_size, 0); // zero‑filled block
+
+    const auto hasher = make_hasher(cfg_.hash_algo);
+    hasher->update(blk.data(), blk.size());
+    return hasher->raw_digest();
+}
+
+/* --------------------------------------------------------------------- */
+std::size_t DuplicateFinder::worker_count() const {
+    if (cfg_.threads > 0) return cfg_.threads;
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+/* --------------------------------------------------------------------- */
+/* Split a bucket by the digest of its block_index‑th block              */
+std::vector<std::vector<bfs::path> > DuplicateFinder::rebucket(
+    const std::vector<bfs::path> &bucket, const std::size_t block_index) const {
+    // Small buckets (the common case) stay on this thread; a giant one is cut into
+    // disjoint index ranges, one per worker. Workers hash their range and insert
+    // (digest → file index) into a sharded table, so they only serialise on the
+    // rare shard collision instead of on one shared map.
+    const std::size_t workers = bucket.size() < PARALLEL_BUCKET_THRESHOLD
+                                    ? 1
+                                    : std::min(worker_count(), bucket.size());
+
+    ShardedDigestTable table(workers == 1 ? 1 : workers * SHARDS_PER_WORKER);
+
+    auto hash_range = [&](const std::size_t first, const std::size_t last) {
+        for (std::size_t i = first; i < last; ++i)
+            table.insert(block_digest(bucket[i], block_index), i);
+    };
+
+    if (workers == 1) {
+        hash_range(0, bucket.size());
+    } else {
+        std::vector<std::thread> pool;
+        std::vector<std::exception_ptr> errors(workers);
+        const std::size_t chunk = (bucket.size() + workers - 1) / workers;
+
+        for (std::size_t w = 0; w < workers; ++w) {
+            const std::size_t first = w * chunk;
+            const std::size_t last = std::min(bucket.size(), first + chunk);
+            if (first >= last) break;
+            pool.emplace_back([&, w, first, last] {
+                try {
+                    hash_range(first, last);
+                } catch (...) {
+                    errors[w] = std::current_exception(); // rethrown on the calling thread
+                }
+            });
+        }
+        for (auto &t: pool) t.join();
+        for (auto &e: errors)
+            if (e) std::rethrow_exception(e);
+    }
+
+    // Merge: map surviving index groups back to paths; singletons are dropped –
+    // they cannot be duplicates.
+    std::vector<std::vector<bfs::path> > survivors;
+    for (const auto &indices: table.extract_groups(2)) {
+        std::vector<bfs::path> group;
+        group.reserve(indices.size());
+        for (const std::size_t i: indices) group.push_back(bucket[i]);
+        survivors.push_back(std::move(group));
+    }
+    return survivors;
+}
@@ -1,76 +1,166 @@
 #include <algorithm>
+#include <array>
+#include <charconv>
+#include <concepts>
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <cstdint>
 #include <list>
+#include <ranges>
+#include <span>
+#include <stdexcept>
 #include <vector>
 #include <tuple>
+#include <type_traits>
+#include <utility>
+#include "../ip_filter/ip_address.h"
 
 template<typename T>
 concept ip_integer =
         std::same_as<T, int8_t> || std::same_as<T, int16_t> || std::same_as<T, int32_t> || std::same_as<T, int64_t>;
 
 template<typename T>
-concept ip_container =
-        std::same_as<T, std::vector<typename T::value_type> > || std::same_as<T, std::list<typename T::value_type> >;
+concept ip_string = std::same_as<T, std::string>;
 
+// packed addresses of ip_filter: IPv4 (32-bit) or either family as a 128-bit key
 template<typename T>
-concept ip_string = std::same_as<T, std::string>;
+concept ip_address = std::same_as<T, IPv4Address> || std::same_as<T, IPAddress>;
+
+// element of a container or tuple address: an integer (bool and characters excluded) or text
+template<typename T>
+concept ip_element =
+        (std::integral<T> && !std::same_as<T, bool> && !std::same_as<T, char>) ||
+        std::convertible_to<const T &, std::string_view>;
 
+// container is any forward range of elements (vector, list, array, span, C array, ...);
+// strings are ranges of char too, but are printed as a whole by the ip_string overload
+template<typename T>
+concept ip_container =
+        std::ranges::forward_range<const T> && !std::convertible_to<const T &, std::string_view> &&
+        ip_element<std::ranges::range_value_t<const T> >;
 
-// Perhaps a better alternative to consider - container is everything that has size(), begin() and end()
-// however, string fall into this category - so above concept is preferred
-// template<typename T>
-// concept container = requires(T c) {
-//     { c.size() } -> std::convertible_to<std::size_t>;
-//     { c.begin() };
-//     { c.end()   };
-// };
+// Output of print_ip: called with consecutive pieces of text.
+template<typename S>
+concept ip_sink = requires(S &sink, const std::string_view text) { sink(text); };
 
-template<ip_string T>
-auto print_ip(const T &ip) {
-    std::cout << ip << std::endl;
-}
+// writes to a stream, std::cout by default
+struct StreamSink {
+    std::ostream *os = &std::cout;
 
-template<ip_container T>
-void print_ip(T ip) {
-    for (size_t i = 0; i < ip.size(); ++i) {
-        if (i > 0) {
-            std::cout << ".";
-        }
-        auto it = std::next(ip.begin(), i); // advance begin() by i steps
-        std::cout << *it;
-        // std::cout << ip.at(i);  // no [] and at() overloads for list so falling back to iterator pointer
+    void operator()(const std::string_view text) const { *os << text; }
+};
+
+// appends to a preallocated buffer; throws std::length_error instead of writing past its end
+struct BufferSink {
+    std::span<char> buffer;
+    std::size_t size = 0;
+
+    void operator()(const std::string_view text) {
+        if (text.size() > buffer.size() - size) throw std::length_error("print_ip: buffer is full");
+        std::ranges::copy(text, buffer.begin() + static_cast<std::ptrdiff_t>(size));
+        size += text.size();
     }
-    std::cout << std::endl;
+
+    [[nodiscard]] std::string_view view() const { return {buffer.data(), size}; }
+};
+
+// Fixed-capacity string on the stack: no allocation, usable in constant expressions
+template<std::size_t Capacity>
+struct IpText {
+    std::array<char, Capacity> data{};
+    std::size_t size = 0;
+
+    constexpr void push_back(const char c) { data[size++] = c; }
+
+    [[nodiscard]] constexpr std::string_view view() const { return {data.data(), size}; }
+};
+
+template<std::size_t Capacity>
+std::ostream &operator<<(std::ostream &os, const IpText<Capacity> &text) {
+    return os << text.view();
 }
 
+// Bytes of an integer, most significant first, each as unsigned decimal, joined by dots.
+// The byte loop is unrolled at compile time; the longest text is "255." per byte.
 template<ip_integer T>
-auto print_ip(T ip) {
-    const auto n_bytes = sizeof(T);
-    std::vector<int> out;
-    out.reserve(n_bytes);
-    for (std::size_t i = 0; i < n_bytes; ++i) {
-        std::size_t shift = 8 * (n_bytes - i - 1);
-        const int ip_byte = static_cast<int>(ip >> shift & 0xFF);
-        out.push_back(ip_byte); // ip >> shift is equivalent to ip* + shift
+constexpr IpText<4 * sizeof(T)> format_ip(const T ip) {
+    using U = std::make_unsigned_t<T>;
+    const auto bits = static_cast<U>(ip);
+    IpText<4 * sizeof(T)> text;
+    auto append_byte = [&]<std::size_t I>(std::integral_constant<std::size_t, I>) {
+        const auto byte = static_cast<std::uint8_t>(bits >> 8 * (sizeof(T) - I - 1));
+        if (byte >= 100) text.push_back(static_cast<char>('0' + byte / 100));
+        if (byte >= 10) text.push_back(static_cast<char>('0' + byte / 10 % 10));
+        text.push_back(static_cast<char>('0' + byte % 10));
+        if (I + 1 < sizeof(T)) text.push_back('.');
+    };
+    [&]<std::size_t... I>(std::index_sequence<I...>) {
+        (append_byte(std::integral_constant<std::size_t, I>{}), ...);
+    }(std::make_index_sequence<sizeof(T)>{});
+    return text;
+}
+
+static_assert(format_ip(int8_t{-1}).view() == "255");
+static_assert(format_ip(int16_t{0}).view() == "0.0");
+static_assert(format_ip(int32_t{2130706433}).view() == "127.0.0.1");
+static_assert(format_ip(int64_t{8875824491850138409}).view() == "123.45.67.89.101.112.131.41");
+
+// integers are written without allocation, other elements as text
+template<ip_element T, ip_sink Sink>
+void write_element(Sink &sink, const T &element) {
+    if constexpr (std::integral<T>) {
+        char text[24]; // any 64-bit value with its sign
+        const auto [end, ec] = std::to_chars(std::begin(text), std::end(text), element);
+        sink(std::string_view(text, end));
+    } else {
+        sink(std::string_view(element));
+    }
+}
+
+template<ip_string T, ip_sink Sink = StreamSink>
+void print_ip(const T &ip, Sink &&sink = Sink{}) {
+    sink(ip);
+    sink("\n");
+}
+
+template<ip_address T, ip_sink Sink = StreamSink>
+void print_ip(const T &ip, Sink &&sink = Sink{}) {
+    // dotted quad for IPv4, RFC 5952 canonical text for IPv6
+    char text[IP_TEXT_MAX_SIZE];
+    sink(std::string_view(text, format_ip_to(text, IPAddress(ip))));
+    sink("\n");
+}
+
+template<ip_container T, ip_sink Sink = StreamSink>
+void print_ip(const T &ip, Sink &&sink = Sink{}) {
+    // elements streamed in one pass of the iterator: no [] and at() overloads for list
+    bool first = true;
+    for (const auto &element: ip) {
+        if (!first) sink(".");
+        write_element(sink, element);
+        first = false;
     }
-    print_ip(out); // use template for containers here
+    sink("\n");
 }
 
-template<typename T, typename... Ts>
+template<ip_integer T, ip_sink Sink = StreamSink>
+void print_ip(const T ip, Sink &&sink = Sink{}) {
+    sink(format_ip(ip).view()); // formatted on the stack, no intermediate container
+    sink("\n");
+}
+
+template<ip_element T, typename... Ts, ip_sink Sink = StreamSink>
     requires (std::same_as<T, Ts> && ...)  // ensures every `Ts` is the same type as `T`
-auto print_ip(const std::tuple<T, Ts...> &ip) {
-    // collect all elements into a vector<T>
-    std::vector<T> out;
-    out.reserve(sizeof...(Ts) + 1);
-    std::apply([&](auto &&... args) {
-        (out.push_back(args), ...);
+void print_ip(const std::tuple<T, Ts...> &ip, Sink &&sink = Sink{}) {
+    // elements written in place by a fold over the tuple, no intermediate container
+    std::apply([&](const T &head, const Ts &... tail) {
+        write_element(sink, head);
+        ((sink("."), write_element(sink, tail)), ...);
     }, ip);
-    print_ip(out); // use template for containers here
+    sink("\n");
 }
 
-
 int main() {
     print_ip(int8_t{-1});
     print_ip(int16_t{0}); // 0.0
@@ -82,4 +172,16 @@ int main() {
     print_ip(std::list<int>{400, 300, 200, 100}); // 400.300.200.100
     print_ip(std::make_tuple(123, 456, 789, 0)); // 123.456.789.0
     // print_ip(std::make_tuple(123, 456, 789, "0")); // elements are not of the same type - won't compile
+    print_ip(IPv4Address(127, 0, 0, 1)); // 127.0.0.1
+    print_ip(parse_ip("2001:0db8:0000:0000:0000:ff00:0042:8329")); // 2001:db8::ff00:42:8329
+    print_ip(std::array{10, 0, 0, 1}); // 10.0.0.1
+    constexpr int bytes[] = {192, 168, 0, 1};
+    print_ip(std::span(bytes).first(2)); // 192.168
+
+    // any sink: here a preallocated buffer, printed afterwards
+    std::array<char, 64> buffer{};
+    BufferSink sink{buffer};
+    print_ip(int32_t{-1062731775}, sink);
+    print_ip(std::make_tuple(std::string("fe80"), std::string("1")), sink);
+    std::cout << sink.view(); // 192.168.0.1 and fe80.1 on separate lines
 }
@@ -0,0 +1,268 @@
+#pragma once
+#include <algorithm>
+#include <compare>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+// IPV4 addresses can have 4 3-digit decimals only with each decimal max to be 255 (1 byte each)
+// https://en.wikipedia.org/wiki/Dot-decimal_notation
+constexpr int IPV4_DOT_DECIMAL_DIGIT_SIZE_LIMIT = 3;
+constexpr int IPV4_DOT_DECIMAL_NUMBER_CONSTANT = 4;
+constexpr int IPV4_DOT_DECIMAL_MAX = 255;
+
+// IPv4 address packed into one 32-bit integer, first octet in the most significant byte:
+// 4 bytes per address instead of a vector of four strings, and the integer order is the
+// lexicographic order of the octets, so addresses compare and sort as plain numbers.
+struct IPv4Address {
+    std::uint32_t value = 0;
+
+    constexpr IPv4Address() = default;
+
+    constexpr explicit IPv4Address(const std::uint32_t packed) : value(packed) {
+    }
+
+    constexpr IPv4Address(const std::uint8_t a, const std::uint8_t b, const std::uint8_t c, const std::uint8_t d)
+        : value(static_cast<std::uint32_t>(a) << 24 | static_cast<std::uint32_t>(b) << 16 |
+                static_cast<std::uint32_t>(c) << 8 | d) {
+    }
+
+    // octet(0) is the first (leftmost) number of the dotted notation
+    [[nodiscard]] constexpr std::uint8_t octet(const int i) const {
+        return static_cast<std::uint8_t>(value >> (8 * (IPV4_DOT_DECIMAL_NUMBER_CONSTANT - 1 - i)));
+    }
+
+    constexpr auto operator<=>(const IPv4Address &) const = default;
+};
+
+// Parses dotted-quad notation ("123.4.56.7") in a single pass without allocating.
+// Exactly 4 numbers of 1-3 digits, each at most 255, separated by single dots, nothing else;
+// returns false for anything else and leaves out untouched.
+constexpr bool parse_ipv4(const std::string_view s, IPv4Address &out) {
+    std::uint32_t packed = 0;
+    std::size_t pos = 0;
+    for (int i = 0; i < IPV4_DOT_DECIMAL_NUMBER_CONSTANT; ++i) {
+        if (i > 0) {
+            if (pos >= s.size() || s[pos] != '.') return false;
+            ++pos;
+        }
+        std::uint32_t number = 0;
+        int digits = 0;
+        for (; pos < s.size() && s[pos] >= '0' && s[pos] <= '9'; ++pos) {
+            if (++digits > IPV4_DOT_DECIMAL_DIGIT_SIZE_LIMIT) return false;
+            number = number * 10 + static_cast<std::uint32_t>(s[pos] - '0');
+        }
+        if (digits == 0 || number > IPV4_DOT_DECIMAL_MAX) return false;
+        packed = packed << 8 | number;
+    }
+    if (pos != s.size()) return false;
+    out.value = packed;
+    return true;
+}
+
+inline IPv4Address parse_ipv4(const std::string_view s) {
+    IPv4Address ip;
+    if (!parse_ipv4(s, ip)) throw std::invalid_argument("Invalid IPv4 address: " + std::string(s));
+    return ip;
+}
+
+static_assert(IPv4Address(1, 2, 3, 4).value == 0x01020304);
+static_assert(IPv4Address(1, 2, 3, 4).octet(0) == 1 && IPv4Address(1, 2, 3, 4).octet(3) == 4);
+static_assert(IPv4Address(2, 0, 0, 0) > IPv4Address(1, 255, 255, 255));
+static_assert([] {
+    IPv4Address ip;
+    return parse_ipv4("255.0.10.1", ip) && ip == IPv4Address(255, 0, 10, 1);
+}());
+static_assert([] {
+    IPv4Address ip;
+    return !parse_ipv4("256.1.1.1", ip) && !parse_ipv4("1.2.3", ip) && !parse_ipv4("1.2.3.4.", ip) &&
+           !parse_ipv4("1..2.3", ip) && !parse_ipv4("0001.2.3.4", ip) && !parse_ipv4("", ip);
+}());
+
+constexpr int IPV6_GROUP_COUNT = 8;
+// longest text form: "ffff:ffff:ffff:ffff:ffff:ffff:255.255.255.255"
+constexpr std::size_t IP_TEXT_MAX_SIZE = 45;
+
+// IPv4 or IPv6 address as one 128-bit key, kept as two 64-bit halves (most significant first), so
+// addresses of both families compare, sort and match prefixes as plain numbers.
+// IPv4 addresses are held IPv4-mapped (::ffff:a.b.c.d, RFC 4291 section 2.5.5.2).
+struct IPAddress {
+    std::uint64_t hi = 0;
+    std::uint64_t lo = 0;
+
+    constexpr IPAddress() = default;
+
+    constexpr IPAddress(const std::uint64_t high, const std::uint64_t low) : hi(high), lo(low) {
+    }
+
+    constexpr explicit IPAddress(const IPv4Address v4) : hi(0), lo(IPV4_MAPPED_PREFIX | v4.value) {
+    }
+
+    [[nodiscard]] constexpr bool is_v4() const { return hi == 0 && lo >> 32 == IPV4_MAPPED_PREFIX >> 32; }
+
+    // only meaningful if is_v4()
+    [[nodiscard]] constexpr IPv4Address v4() const { return IPv4Address(static_cast<std::uint32_t>(lo)); }
+
+    // group(0) is the first (leftmost) 16-bit group of the text notation
+    [[nodiscard]] constexpr std::uint16_t group(const int i) const {
+        const std::uint64_t half = i < IPV6_GROUP_COUNT / 2 ? hi : lo;
+        return static_cast<std::uint16_t>(half >> (16 * (IPV6_GROUP_COUNT / 2 - 1 - i % (IPV6_GROUP_COUNT / 2))));
+    }
+
+    constexpr auto operator<=>(const IPAddress &) const = default;
+
+    static constexpr std::uint64_t IPV4_MAPPED_PREFIX = 0xFFFF'0000'0000;
+};
+
+// Parses IPv6 text notation (RFC 4291 section 2.2): 8 groups of 1-4 hex digits, at most one "::"
+// standing for one or more zero groups, optionally ending in dotted IPv4 ("::ffff:1.2.3.4").
+// Zone indices ("%eth0") are not accepted.
+constexpr bool parse_ipv6(const std::string_view s, IPAddress &out) {
+    std::uint16_t groups[IPV6_GROUP_COUNT] = {};
+    int count = 0;          // groups parsed
+    int gap = -1;           // position of "::" among the groups, if any
+    std::size_t pos = 0;
+    if (s.starts_with("::")) {
+        gap = 0;
+        pos = 2;
+    }
+    while (pos < s.size()) {
+        const std::size_t end = std::min(s.find(':', pos), s.size());
+        const std::string_view piece = s.substr(pos, end - pos);
+        if (piece.find('.') != std::string_view::npos) {
+            // embedded IPv4 takes the last two groups and must end the address
+            IPv4Address v4;
+            if (end != s.size() || count > IPV6_GROUP_COUNT - 2 || !parse_ipv4(piece, v4)) return false;
+            groups[count++] = static_cast<std::uint16_t>(v4.value >> 16);
+            groups[count++] = static_cast<std::uint16_t>(v4.value);
+            pos = end;
+            break;
+        }
+        if (piece.empty() || piece.size() > 4 || count == IPV6_GROUP_COUNT) return false;
+        std::uint16_t group = 0;
+        for (const char c: piece) {
+            int digit;
+            if (c >= '0' && c <= '9') digit = c - '0';
+            else if (c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') digit = c - 'A' + 10;
+            else return false;
+            group = static_cast<std::uint16_t>(group << 4 | digit);
+        }
+        groups[count++] = group;
+        pos = end;
+        if (pos == s.size()) break;
+        ++pos; // ':'
+        if (pos < s.size() && s[pos] == ':') {
+            if (gap >= 0) return false; // a second "::"
+            gap = count;
+            ++pos;
+        } else if (pos == s.size()) {
+            return false; // trailing single ':'
+        }
+    }
+    if (gap < 0 ? count != IPV6_GROUP_COUNT : count == IPV6_GROUP_COUNT) return false;
+
+    // move the groups after "::" to the end, zeros in between
+    std::uint16_t full[IPV6_GROUP_COUNT] = {};
+    const int tail = gap < 0 ? 0 : count - gap;
+    for (int i = 0; i < count - tail; ++i) full[i] = groups[i];
+    for (int i = 0; i < tail; ++i) full[IPV6_GROUP_COUNT - tail + i] = groups[count - tail + i];
+    std::uint64_t hi = 0;
+    std::uint64_t lo = 0;
+    for (int i = 0; i < IPV6_GROUP_COUNT / 2; ++i) {
+        hi = hi << 16 | full[i];
+        lo = lo << 16 | full[IPV6_GROUP_COUNT / 2 + i];
+    }
+    out = IPAddress(hi, lo);
+    return true;
+}
+
+// Either notation; IPv4 is tried first, so IPv4 input pays nothing for IPv6 support.
+constexpr bool parse_ip(const std::string_view s, IPAddress &out) {
+    if (IPv4Address v4; parse_ipv4(s, v4)) {
+        out = IPAddress(v4);
+        return true;
+    }
+    return parse_ipv6(s, out);
+}
+
+inline IPAddress parse_ip(const std::string_view s) {
+    IPAddress ip;
+    if (!parse_ip(s, ip)) throw std::invalid_argument("Invalid IP address: " + std::string(s));
+    return ip;
+}
+
+// Writes the text form at out (at most IP_TEXT_MAX_SIZE chars) and returns the end of it.
+// IPv4-mapped addresses are written in dotted-quad notation, IPv6 in the canonical form of
+// RFC 5952: lowercase, no leading zeros, the longest run (2+) of zero groups shortened to "::".
+constexpr char *format_ip_to(char *out, const IPAddress &ip) {
+    auto put_decimal = [&out](const unsigned v) {
+        if (v >= 100) *out++ = static_cast<char>('0' + v / 100);
+        if (v >= 10) *out++ = static_cast<char>('0' + v / 10 % 10);
+        *out++ = static_cast<char>('0' + v % 10);
+    };
+    if (ip.is_v4()) {
+        for (int i = 0; i < IPV4_DOT_DECIMAL_NUMBER_CONSTANT; ++i) {
+            if (i > 0) *out++ = '.';
+            put_decimal(ip.v4().octet(i));
+        }
+        return out;
+    }
+
+    int best_start = -1;
+    int best_len = 1; // runs of a single zero group are not shortened
+    for (int i = 0; i < IPV6_GROUP_COUNT;) {
+        int j = i;
+        while (j < IPV6_GROUP_COUNT && ip.group(j) == 0) ++j;
+        if (j - i > best_len) {
+            best_start = i;
+            best_len = j - i;
+        }
+        i = j == i ? i + 1 : j;
+    }
+    for (int i = 0; i < IPV6_GROUP_COUNT; ++i) {
+        if (i == best_start) {
+            *out++ = ':';
+            if (i == 0) *out++ = ':';
+            i += best_len - 1;
+            continue;
+        }
+        const std::uint16_t g = ip.group(i);
+        bool started = false;
+        for (int shift = 12; shift >= 0; shift -= 4) {
+            const int digit = g >> shift & 0xF;
+            if (!started && digit == 0 && shift > 0) continue;
+            started = true;
+            *out++ = "0123456789abcdef"[digit];
+        }
+        if (i < IPV6_GROUP_COUNT - 1) *out++ = ':';
+    }
+    return out;
+}
+
+inline std::string format_ip(const IPAddress &ip) {
+    char text[IP_TEXT_MAX_SIZE];
+    return {text, format_ip_to(text, ip)};
+}
+
+static_assert(IPAddress(IPv4Address(1, 2, 3, 4)).is_v4() && IPAddress(IPv4Address(1, 2, 3, 4)).v4().value == 0x01020304);
+static_assert([] {
+    IPAddress ip;
+    return parse_ip("2001:db8::1", ip) && ip == IPAddress(0x2001'0db8'0000'0000, 1) &&
+           parse_ip("::", ip) && ip == IPAddress() &&
+           parse_ip("::ffff:10.0.0.1", ip) && ip == IPAddress(IPv4Address(10, 0, 0, 1)) &&
+           parse_ip("1:2:3:4:5:6:7:8", ip) && ip.group(7) == 8 && ip.group(0) == 1 &&
+           !parse_ip("1:2:3:4:5:6:7:8:9", ip) && !parse_ip("1::2::3", ip) && !parse_ip("1:2:3:4:5:6:7:8::", ip) &&
+           !parse_ip(":1::", ip) && !parse_ip("1:", ip) && !parse_ip("12345::", ip) && !parse_ip("1.2.3.4::", ip);
+}());
+static_assert([] {
+    IPAddress ip;
+    char text[IP_TEXT_MAX_SIZE];
+    auto same = [&](const std::string_view in, const std::string_view expected) {
+        return parse_ip(in, ip) && std::string_view(text, format_ip_to(text, ip)) == expected;
+    };
+    return same("2001:0DB8:0:0:0:0:0:1", "2001:db8::1") && same("::", "::") && same("::1", "::1") &&
+           same("1::", "1::") && same("1:0:0:2:0:0:0:3", "1:0:0:2::3") && same("1:0:2:3:4:5:6:7", "1:0:2:3:4:5:6:7") &&
+           same("::ffff:192.168.0.1", "192.168.0.1") && same("10.0.0.255", "10.0.0.255");
+}());
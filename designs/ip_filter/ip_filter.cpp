@@ -1,121 +1,194 @@
 #include <algorithm>
-#include <cassert>
 #include <iostream>
 #include <filesystem>
 #include <fstream>
 #include <ranges>
 #include <string>
 #include <vector>
+#include "ip_address.h"
+#include "ip_index.h"
+#include "ip_loader.h"
+#include "ip_output.h"
+#include "ip_ranges.h"
+#include "ip_stats.h"
 
-// IPV4 addresses can have 4 3-digit decimals only with each decimal max to be 255 (1 byte each)
-// https://en.wikipedia.org/wiki/Dot-decimal_notation
-static int IPV4_DOT_DECIMAL_DIGIT_SIZE_LIMIT = 3;
-static int IPV4_DOT_DECIMAL_NUMBER_CONSTANT = 4;
-static int IPV4_DOT_DECIMAL_MAX = 255;
-
-// ("",  '.') -> [""]
-// ("11", '.') -> ["11"]
-// ("..", '.') -> ["", "", ""]
-// ("11.", '.') -> ["11", ""]
-// (".11", '.') -> ["", "11"]
-// ("11.22", '.') -> ["11", "22"]
-std::vector<std::string> split(const std::string &str, const char d) {
-    std::vector<std::string> r;
-
-    std::string::size_type start = 0;
-    std::string::size_type stop = str.find_first_of(d);
-    while (stop != std::string::npos) {
-        r.push_back(str.substr(start, stop - start));
-
-        start = stop + 1;
-        stop = str.find_first_of(d, start);
-    }
+namespace {
+    constexpr auto usage =
+            " [--input <file.tsv|->] [--ranges <file> | --count <exact|approx> [--top <k>]] [--format <text|binary>]\n";
 
-    r.push_back(str.substr(start));
+    constexpr std::size_t APPROX_DEFAULT_TOP = 10;
 
-    return r;
-}
+    struct Options {
+        // TSV with the address in the first column; "-" reads stdin
+        std::string input_path = "../designs/ip_filter/ip_filter.tsv";
+        // file of CIDR blocks / ranges (one per line): print only the addresses inside them
+        std::string ranges_path;
+        // text - one address per line; binary - network byte order, 4 bytes per address for IPv4-only
+        // input, otherwise 16 bytes per address (IPv4 as ::ffff:a.b.c.d)
+        IpWriter::Format format = IpWriter::Format::TEXT;
+        // hit counts instead of the filters: exact - every distinct address (sorted pool, run-length);
+        // approx - streaming sketches in fixed memory: distinct estimate and heavy hitters
+        std::string count_mode;
+        // report only the k most frequent addresses (0 - all for exact, APPROX_DEFAULT_TOP for approx)
+        std::size_t top = 0;
+    };
 
-void print_ipv4_vectors(const std::vector<std::vector<std::string> > &ip_pool) {
-    for (const auto &ip: ip_pool) {
-        for (size_t i = 0; i < ip.size(); ++i) {
-            if (i > 0) {
-                std::cout << ".";
+    // options come in "--name value" pairs; returns false on any error
+    bool parse_options(const int argc, char const *argv[], Options &opt) {
+        for (int i = 1; i < argc; i += 2) {
+            if (i + 1 >= argc) return false;
+            const std::string option = argv[i];
+            if (option == "--input") opt.input_path = argv[i + 1];
+            else if (option == "--ranges") opt.ranges_path = argv[i + 1];
+            else if (option == "--count") {
+                opt.count_mode = argv[i + 1];
+                if (opt.count_mode != "exact" && opt.count_mode != "approx") return false;
+            }
+            else if (option == "--top") {
+                try { opt.top = std::stoul(argv[i + 1]); }
+                catch (...) { return false; }
+                if (opt.top == 0) return false;
             }
-            std::cout << ip[i];
+            else if (option == "--format") {
+                const std::string format = argv[i + 1];
+                if (format == "text") opt.format = IpWriter::Format::TEXT;
+                else if (format == "binary") opt.format = IpWriter::Format::BINARY;
+                else return false;
+            }
+            else return false;
         }
-        std::cout << std::endl;
+        if (opt.top > 0 && opt.count_mode.empty()) return false;
+        return opt.ranges_path.empty() || opt.count_mode.empty();
     }
-}
 
-auto filter(const std::vector<std::vector<std::string> > &ip_pool, const int first_byte) {
-    std::vector<std::vector<std::string> > ip_output;
-    for (auto ip: ip_pool) {
-        if (std::stoi(ip[0]) == first_byte) {
-            ip_output.push_back(ip);
+    // Writes two address sequences, each in descending order, as one descending sequence.
+    // IPv4 addresses are compared IPv4-mapped and written as IPAddress so all records share a format.
+    template<std::ranges::input_range V4Range, std::ranges::input_range V6Range>
+    void write_merged(IpWriter &out, V4Range &&v4, V6Range &&v6) {
+        auto a = std::ranges::begin(v4);
+        auto b = std::ranges::begin(v6);
+        const auto a_end = std::ranges::end(v4);
+        const auto b_end = std::ranges::end(v6);
+        while (a != a_end || b != b_end) {
+            if (b == b_end || (a != a_end && IPAddress(*a) > *b)) out.write(IPAddress(*a++));
+            else out.write(*b++);
         }
     }
-    return ip_output;
-};
 
+    // Exact hit counts: equal addresses are adjacent in the sorted pools, so counting is one pass.
+    // Without top: "<address>\t<count>" for every distinct address, in descending address order;
+    // with top: the k most frequent.
+    void report_exact_counts(IpWriter &out, const IpIndex &index, const std::vector<IPAddress> &ipv6_pool,
+                             const std::size_t top) {
+        auto v4_counts = ip_stats::count_sorted(index.addresses());
+        auto v6_counts = ip_stats::count_sorted<IPAddress>(ipv6_pool);
+        if (top == 0 && v6_counts.empty()) {
+            for (const auto &[ip, count]: v4_counts) out.write(ip, count);
+            return;
+        }
 
-auto filter(const std::vector<std::vector<std::string> > &ip_pool, const int first_byte, const int second_byte) {
-    std::vector<std::vector<std::string> > ip_output;
-    for (auto ip: ip_pool) {
-        if (std::stoi(ip[0]) == first_byte && std::stoi(ip[1]) == second_byte) {
-            ip_output.push_back(ip);
+        std::vector<ip_stats::Counted<IPAddress> > all;
+        if (top > 0) {
+            // top k of each family, then of the union
+            ip_stats::top_k(v4_counts, top);
+            ip_stats::top_k(v6_counts, top);
         }
+        all.reserve(v4_counts.size() + v6_counts.size());
+        for (const auto &[ip, count]: v4_counts) all.push_back({IPAddress(ip), count});
+        all.insert(all.end(), v6_counts.begin(), v6_counts.end());
+        if (top > 0) ip_stats::top_k(all, top);
+        else std::ranges::sort(all, std::greater{}, &ip_stats::Counted<IPAddress>::address);
+        for (const auto &[ip, count]: all) out.write(ip, count);
     }
-    return ip_output;
-};
-
-auto filter_any(const std::vector<std::vector<std::string> > &ip_pool, const int byte) {
-    std::vector<std::vector<std::string> > ip_output;
-    for (auto ip: ip_pool) {
-        if (std::stoi(ip[0]) == byte || std::stoi(ip[1]) == byte || std::stoi(ip[2]) == byte || std::stoi(ip[3]) ==
-            byte) {
-            ip_output.push_back(ip);
+
+    // Approximate report over a stream of any size, in fixed memory: the number of distinct addresses
+    // (HyperLogLog, to stderr) and the top most frequent ones (Space-Saving). Each count is the smaller
+    // of the Space-Saving and Count-Min upper bounds: close for real heavy hitters, but on a flat
+    // distribution the tail of the report is noise.
+    void report_approx_counts(IpWriter &out, const std::string &path, const std::size_t top) {
+        ip_stats::HyperLogLog distinct;
+        ip_stats::CountMinSketch frequency;
+        // tracking more entries than reported keeps the reported ones accurate
+        ip_stats::SpaceSaving heavy_hitters(std::max<std::size_t>(top * 10, 1000));
+        std::uint64_t total = 0;
+        ip_loader::scan(path, [&](const IPAddress &ip) {
+            distinct.add(ip);
+            frequency.add(ip);
+            heavy_hitters.add(ip);
+            ++total;
+        });
+
+        std::cerr << total << " addresses, about " << static_cast<std::uint64_t>(distinct.estimate() + 0.5)
+                << " distinct\n";
+        std::vector<ip_stats::Counted<IPAddress> > hitters;
+        for (const auto &e: heavy_hitters.entries()) {
+            hitters.push_back({e.address, std::min(e.count, frequency.estimate(e.address))});
         }
+        ip_stats::top_k(hitters, top);
+        for (const auto &[ip, count]: hitters) out.write(ip, count);
     }
-    return ip_output;
-};
+}
 
 int main(int argc, char const *argv[]) {
+    Options opt;
+    if (!parse_options(argc, argv, opt)) {
+        std::cerr << "Usage: " << argv[0] << usage;
+        return 1;
+    }
+
     try {
-        std::vector<std::vector<std::string> > ip_pool;
-        std::ifstream all_ip_addresses("../designs/ip_filter/ip_filter.tsv");
-        if (!all_ip_addresses.is_open()) {
-            std::cerr << "Could not open ip_filter file" << std::endl;
+        if (opt.count_mode == "approx") {
+            IpWriter out(STDOUT_FILENO, opt.format);
+            report_approx_counts(out, opt.input_path, opt.top > 0 ? opt.top : APPROX_DEFAULT_TOP);
+            out.flush();
+            return 0;
         }
 
-        for (std::string line; std::getline(all_ip_addresses, line);) {
-            auto v = split(line, '\t');
-            ip_pool.push_back(split(v.at(0), '.'));
-        }
+        // every address is parsed and validated once, into a packed integer;
+        // files are memory-mapped and parsed in parallel chunks
+        // IPv4 and IPv6 addresses are kept apart, so IPv4 keeps its 32-bit representation and index
+        auto [ip_pool, ipv6_pool] = ip_loader::load(opt.input_path);
 
-        // to ensure that all ip addresses are IPV4 and their dot decimal notation is valid
-        std::ranges::for_each(ip_pool, [](auto &ip) {
-            assert(ip.size() == IPV4_DOT_DECIMAL_NUMBER_CONSTANT);
-            std::ranges::for_each(ip, [](auto &el) {
-                assert(el.size() <= IPV4_DOT_DECIMAL_DIGIT_SIZE_LIMIT);
-                assert(std::stoi(el) <= IPV4_DOT_DECIMAL_MAX);
-            });
-        });
+        // sorted once (radix sort of the packed integers); all filters below are lookups in this index
+        const IpIndex index(std::move(ip_pool));
+        ip_sort::sort_descending(ipv6_pool);
+
+        // results are rendered into one large buffer and written in big chunks; with IPv6 in the input
+        // every binary record is 16 bytes, IPv4 filter results included
+        const bool mixed_binary = opt.format == IpWriter::Format::BINARY && !ipv6_pool.empty();
+        IpWriter out(STDOUT_FILENO, mixed_binary ? IpWriter::Format::BINARY_MAPPED : opt.format);
+
+        if (opt.count_mode == "exact") {
+            report_exact_counts(out, index, ipv6_pool, opt.top);
+            out.flush();
+            return 0;
+        }
 
-        // transforming ip vector [123.4.56.7] into string '123.004.056.007' and compare strings
-        std::ranges::sort(ip_pool, [](const auto &a, const auto &b) {
-            std::string result_a;
-            std::string result_b;
-            for (const auto &a_el: a) {
-                result_a += std::string(IPV4_DOT_DECIMAL_DIGIT_SIZE_LIMIT - std::size(a_el), '0') + a_el + ".";
+        if (!opt.ranges_path.empty()) {
+            std::ifstream ranges_file(opt.ranges_path);
+            if (!ranges_file.is_open()) {
+                std::cerr << "Could not open ranges file " << opt.ranges_path << std::endl;
+                return 1;
             }
-            for (const auto &b_el: b) {
-                result_b += std::string(IPV4_DOT_DECIMAL_DIGIT_SIZE_LIMIT - std::size(b_el), '0') + b_el + ".";
+            // whole pool classified in one merge pass of the sorted pool with the sorted intervals
+            const auto ranges = IPRangeSets::load(ranges_file);
+            const auto v4_runs = ranges.v4.match_runs(index.addresses());
+            if (ipv6_pool.empty()) {
+                for (const auto run: v4_runs) {
+                    out.write(run);
+                }
+            } else {
+                write_merged(out, v4_runs | std::views::join, ranges.v6.match_runs(ipv6_pool) | std::views::join);
             }
-            return (result_a > result_b);
-        });
+            out.flush();
+            return 0;
+        }
 
-        print_ipv4_vectors(ip_pool);
+        if (ipv6_pool.empty()) {
+            out.write(index.addresses());
+        } else {
+            write_merged(out, index.addresses(), ipv6_pool);
+        }
 
         // 222.173.235.246
         // 222.130.177.64
@@ -125,8 +198,10 @@ int main(int argc, char const *argv[]) {
         // 1.29.168.152
         // 1.1.234.8
 
-        auto ip_filtered_first_byte = filter(ip_pool, 1);
-        print_ipv4_vectors(ip_filtered_first_byte);
+        // octet filters are defined for IPv4 addresses only
+
+        auto ip_filtered_first_byte = index.filter(1);
+        out.write(ip_filtered_first_byte);
 
         // 1.231.69.33
         // 1.87.203.225
@@ -134,16 +209,16 @@ int main(int argc, char const *argv[]) {
         // 1.29.168.152
         // 1.1.234.8
 
-        auto ip_filtered_first_second_byte = filter(ip_pool, 46, 70);
-        print_ipv4_vectors(ip_filtered_first_second_byte);
+        auto ip_filtered_first_second_byte = index.filter(46, 70);
+        out.write(ip_filtered_first_second_byte);
 
         // 46.70.225.39
         // 46.70.147.26
         // 46.70.113.73
         // 46.70.29.76
 
-        auto ip_filtered_any_byte = filter_any(ip_pool, 46);
-        print_ipv4_vectors(ip_filtered_any_byte);
+        auto ip_filtered_any_byte = index.filter_any(46);
+        out.write(ip_filtered_any_byte);
 
         // 186.204.34.46
         // 186.46.222.194
@@ -179,6 +254,8 @@ int main(int argc, char const *argv[]) {
         // 46.49.43.85
         // 39.46.86.85
         // 5.189.203.46
+
+        out.flush();
     } catch (const std::exception &e) {
         std::cerr << e.what() << std::endl;
     }
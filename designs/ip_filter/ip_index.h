@@ -0,0 +1,168 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <vector>
+#include "ip_address.h"
+#include "ip_sort.h"
+
+// Query engine over a pool of addresses, sorted once in descending order on construction.
+//  - prefix filters (first octet, first two octets): the matching addresses are one contiguous run
+//    of the sorted pool, found by binary search and returned as a span - no copy, no allocation;
+//  - any-octet filter: for octets 2..4 a posting list per octet value holds the (ascending) positions
+//    of the addresses having that value there; built in O(n) on the first filter_any() call, so the
+//    modes that never use it (counts, ranges) do not pay for it.
+//    filter_any() returns a lazy view merging the first-octet run with three posting lists, so results
+//    come out in pool order and each address once.
+class IpIndex {
+public:
+    using Position = std::uint32_t;
+
+    class AnyOctetView;
+
+    explicit IpIndex(std::vector<IPv4Address> pool) : pool_(std::move(pool)) {
+        if (pool_.size() > std::numeric_limits<Position>::max())
+            throw std::length_error("IpIndex holds at most 2^32 - 1 addresses");
+        ip_sort::parallel_sort_descending(pool_);
+    }
+
+    // The whole pool in descending order.
+    [[nodiscard]] std::span<const IPv4Address> addresses() const noexcept { return pool_; }
+
+    [[nodiscard]] std::span<const IPv4Address> filter(const std::uint8_t first_byte) const {
+        return prefix_run(static_cast<std::uint32_t>(first_byte) << 24, 8);
+    }
+
+    [[nodiscard]] std::span<const IPv4Address> filter(const std::uint8_t first_byte, const std::uint8_t second_byte) const {
+        return prefix_run(static_cast<std::uint32_t>(first_byte) << 24 | static_cast<std::uint32_t>(second_byte) << 16, 16);
+    }
+
+    // Addresses with the byte at any of the four positions, in pool order. Thread-safe, like the other
+    // queries: the first call builds the posting lists.
+    [[nodiscard]] AnyOctetView filter_any(std::uint8_t byte) const;
+
+private:
+    static constexpr int INDEXED_POSITIONS = IPV4_DOT_DECIMAL_NUMBER_CONSTANT - 1; // octets 2..4
+
+    // Run of addresses whose top prefix_bits bits equal those of prefix.
+    [[nodiscard]] std::span<const IPv4Address> prefix_run(const std::uint32_t prefix, const int prefix_bits) const {
+        const int shift = 32 - prefix_bits;
+        const auto run = std::ranges::equal_range(pool_, prefix >> shift, std::greater{},
+                                                  [shift](const IPv4Address ip) { return ip.value >> shift; });
+        return {run.begin(), run.end()};
+    }
+
+    // Counting sort of positions by octet value, one pass per indexed octet.
+    void build_postings() const {
+        for (int p = 0; p < INDEXED_POSITIONS; ++p) {
+            auto &offsets = offsets_[p];
+            offsets.fill(0);
+            for (const auto ip: pool_) ++offsets[ip.octet(p + 1) + 1];
+            for (std::size_t v = 1; v < offsets.size(); ++v) offsets[v] += offsets[v - 1];
+            auto next = offsets;
+            postings_[p].resize(pool_.size());
+            for (Position i = 0; i < pool_.size(); ++i) postings_[p][next[pool_[i].octet(p + 1)]++] = i;
+        }
+    }
+
+    [[nodiscard]] std::span<const Position> postings(const int p, const std::uint8_t byte) const {
+        return std::span(postings_[p]).subspan(offsets_[p][byte], offsets_[p][byte + 1] - offsets_[p][byte]);
+    }
+
+    std::vector<IPv4Address> pool_;
+    mutable std::once_flag postings_built_;
+    mutable std::array<std::vector<Position>, INDEXED_POSITIONS> postings_;
+    mutable std::array<std::array<Position, 257>, INDEXED_POSITIONS> offsets_{};
+};
+
+// Forward range over the result of IpIndex::filter_any; merges sorted position lists on the fly.
+class IpIndex::AnyOctetView {
+public:
+    class iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = IPv4Address;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const IPv4Address *;
+        using reference = const IPv4Address &;
+
+        iterator() = default;
+
+        reference operator*() const { return pool_[current_]; }
+        pointer operator->() const { return &pool_[current_]; }
+
+        iterator &operator++() {
+            if (first_lo_ < first_hi_ && first_lo_ == current_) ++first_lo_;
+            for (auto &list: lists_)
+                if (!list.empty() && list.front() == current_) list = list.subspan(1);
+            settle();
+            return *this;
+        }
+
+        iterator operator++(int) {
+            auto old = *this;
+            ++*this;
+            return old;
+        }
+
+        bool operator==(const iterator &other) const { return current_ == other.current_; }
+
+    private:
+        friend class AnyOctetView;
+
+        // positions of the next result from the first-octet run and each posting list
+        iterator(const std::span<const IPv4Address> pool, const Position first_lo, const Position first_hi,
+                 const std::array<std::span<const Position>, INDEXED_POSITIONS> &lists)
+            : pool_(pool), first_lo_(first_lo), first_hi_(first_hi), lists_(lists) {
+            settle();
+        }
+
+        void settle() {
+            current_ = first_lo_ < first_hi_ ? first_lo_ : END;
+            for (const auto &list: lists_)
+                if (!list.empty()) current_ = std::min(current_, list.front());
+        }
+
+        static constexpr Position END = std::numeric_limits<Position>::max();
+
+        std::span<const IPv4Address> pool_;
+        Position first_lo_ = 0;
+        Position first_hi_ = 0;
+        std::array<std::span<const Position>, INDEXED_POSITIONS> lists_{};
+        Position current_ = END;
+    };
+
+    [[nodiscard]] iterator begin() const { return {pool_, first_lo_, first_hi_, lists_}; }
+    [[nodiscard]] iterator end() const { return {}; }
+    [[nodiscard]] bool empty() const { return begin() == end(); }
+
+private:
+    friend class IpIndex;
+
+    AnyOctetView(const std::span<const IPv4Address> pool, const Position first_lo, const Position first_hi,
+                 const std::array<std::span<const Position>, INDEXED_POSITIONS> &lists)
+        : pool_(pool), first_lo_(first_lo), first_hi_(first_hi), lists_(lists) {
+    }
+
+    std::span<const IPv4Address> pool_;
+    Position first_lo_;
+    Position first_hi_;
+    std::array<std::span<const Position>, INDEXED_POSITIONS> lists_;
+};
+
+inline IpIndex::AnyOctetView IpIndex::filter_any(const std::uint8_t byte) const {
+    std::call_once(postings_built_, [this] { build_postings(); });
+    const auto first = filter(byte);
+    const auto lo = static_cast<Position>(first.data() - pool_.data());
+    std::array<std::span<const Position>, INDEXED_POSITIONS> lists;
+    for (int p = 0; p < INDEXED_POSITIONS; ++p) lists[p] = postings(p, byte);
+    return {pool_, lo, static_cast<Position>(lo + first.size()), lists};
+}
+
+static_assert(std::forward_iterator<IpIndex::AnyOctetView::iterator>);
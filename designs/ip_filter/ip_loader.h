@@ -0,0 +1,192 @@
+#pragma once
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <fcntl.h>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "ip_address.h"
+
+// Loads the addresses from the first column of a TSV file (address \t ... \n).
+//  - regular files are memory-mapped and split into one chunk per worker, every chunk boundary moved
+//    to the next line start; chunks are parsed in parallel and concatenated in file order;
+//  - anything else (stdin, pipes) is streamed through a fixed buffer on the calling thread;
+//  - per line only the first field is parsed; the rest is skipped with memchr up to the newline;
+//  - scan() hands the addresses to a callback one by one instead, for inputs larger than memory.
+// Addresses are split by family: IPv4 into packed 32-bit values (IPv4 text is tried first, so an
+// IPv4-only file costs the same as before IPv6 support), IPv6 into 128-bit IPAddress.
+// Empty lines are skipped; any other malformed address throws std::invalid_argument.
+namespace ip_loader {
+    struct AddressPool {
+        std::vector<IPv4Address> v4;
+        std::vector<IPAddress> v6;
+    };
+
+    constexpr std::size_t PARALLEL_LOAD_THRESHOLD = 4 << 20; // bytes; smaller files are parsed on one thread
+    constexpr std::size_t STREAM_BUFFER_SIZE = 1 << 20;
+    constexpr std::string_view STDIN_PATH = "-";
+
+    namespace detail {
+        inline void add_address(const std::string_view field, AddressPool &out) {
+            if (IPv4Address v4; parse_ipv4(field, v4)) {
+                out.v4.push_back(v4);
+                return;
+            }
+            const IPAddress ip = parse_ip(field);
+            if (ip.is_v4()) out.v4.push_back(ip.v4()); // "::ffff:a.b.c.d"
+            else out.v6.push_back(ip);
+        }
+
+        // Hands the first field of all complete lines of data to on_field; returns the number of bytes
+        // consumed (up to the last '\n', or everything if last_chunk).
+        template<typename OnField>
+        std::size_t parse_lines(const std::string_view data, const bool last_chunk, OnField &&on_field) {
+            const char *p = data.data();
+            const char *const end = p + data.size();
+            while (p < end) {
+                const auto *nl = static_cast<const char *>(std::memchr(p, '\n', static_cast<std::size_t>(end - p)));
+                if (!nl && !last_chunk) break;
+                const char *line_end = nl ? nl : end;
+                const char *field_end = p;
+                while (field_end < line_end && *field_end != '\t' && *field_end != '\r') ++field_end;
+                if (field_end != p) on_field(std::string_view(p, static_cast<std::size_t>(field_end - p)));
+                p = nl ? nl + 1 : end;
+            }
+            return static_cast<std::size_t>(p - data.data());
+        }
+
+        inline AddressPool load_mapped(const std::string_view data, const std::size_t workers) {
+            const std::size_t chunks = data.size() < PARALLEL_LOAD_THRESHOLD ? 1 : std::max<std::size_t>(workers, 1);
+            // chunk i covers [bounds[i], bounds[i + 1]); every bound except 0 sits right after a '\n'
+            std::vector<std::size_t> bounds(chunks + 1, data.size());
+            bounds[0] = 0;
+            for (std::size_t i = 1; i < chunks; ++i) {
+                const std::size_t at = std::max(bounds[i - 1], data.size() / chunks * i);
+                const std::size_t nl = data.find('\n', at);
+                bounds[i] = nl == std::string_view::npos ? data.size() : nl + 1;
+            }
+
+            std::vector<AddressPool> parts(chunks);
+            std::vector<std::exception_ptr> errors(chunks);
+            auto parse = [&](const std::size_t i) {
+                try {
+                    const auto chunk = data.substr(bounds[i], bounds[i + 1] - bounds[i]);
+                    parts[i].v4.reserve(chunk.size() / 16); // typical "a.b.c.d\t...\n" line length
+                    parse_lines(chunk, true, [&part = parts[i]](const std::string_view field) { add_address(field, part); });
+                } catch (...) {
+                    errors[i] = std::current_exception();
+                }
+            };
+            {
+                std::vector<std::jthread> threads;
+                for (std::size_t i = 1; i < chunks; ++i) threads.emplace_back(parse, i);
+                parse(0);
+            }
+            for (const auto &e: errors)
+                if (e) std::rethrow_exception(e);
+
+            if (parts.size() == 1) return std::move(parts[0]);
+            AddressPool out;
+            std::size_t total_v4 = 0;
+            std::size_t total_v6 = 0;
+            for (const auto &part: parts) {
+                total_v4 += part.v4.size();
+                total_v6 += part.v6.size();
+            }
+            out.v4.reserve(total_v4);
+            out.v6.reserve(total_v6);
+            for (const auto &part: parts) {
+                out.v4.insert(out.v4.end(), part.v4.begin(), part.v4.end());
+                out.v6.insert(out.v6.end(), part.v6.begin(), part.v6.end());
+            }
+            return out;
+        }
+
+        // Reads fd to the end through one buffer, handing the first field of every line to on_field.
+        template<typename OnField>
+        void stream_lines(const int fd, OnField &&on_field) {
+            std::string buffer(STREAM_BUFFER_SIZE, '\0');
+            std::size_t filled = 0;
+            for (;;) {
+                if (filled == buffer.size()) buffer.resize(buffer.size() * 2); // a line longer than the buffer
+                const ssize_t n = ::read(fd, buffer.data() + filled, buffer.size() - filled);
+                if (n < 0) {
+                    if (errno == EINTR) continue;
+                    throw std::runtime_error(std::string("read failed: ") + std::strerror(errno));
+                }
+                filled += static_cast<std::size_t>(n);
+                const bool eof = n == 0;
+                const std::size_t used = parse_lines(std::string_view(buffer.data(), filled), eof, on_field);
+                // keep the incomplete last line for the next read
+                std::memmove(buffer.data(), buffer.data() + used, filled - used);
+                filled -= used;
+                if (eof) return;
+            }
+        }
+
+        inline AddressPool load_stream(const int fd) {
+            AddressPool out;
+            stream_lines(fd, [&out](const std::string_view field) { add_address(field, out); });
+            return out;
+        }
+
+        // Closes the descriptor on scope exit.
+        struct FdGuard {
+            int fd;
+            ~FdGuard() { ::close(fd); }
+        };
+
+        inline int open_input(const std::string &path) {
+            const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) throw std::runtime_error("Could not open " + path + ": " + std::strerror(errno));
+            return fd;
+        }
+    }
+
+    inline std::size_t default_workers() {
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // Loads a file, or stdin when path is "-".
+    inline AddressPool load(const std::string &path, const std::size_t workers = default_workers()) {
+        if (path == STDIN_PATH) return detail::load_stream(STDIN_FILENO);
+
+        const int fd = detail::open_input(path);
+        const detail::FdGuard guard{fd};
+
+        struct stat st{};
+        if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) return detail::load_stream(fd);
+        const auto size = static_cast<std::size_t>(st.st_size);
+        if (size == 0) return {};
+
+        void *map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) return detail::load_stream(fd);
+        ::madvise(map, size, MADV_SEQUENTIAL);
+        try {
+            auto out = detail::load_mapped(std::string_view(static_cast<const char *>(map), size), workers);
+            ::munmap(map, size);
+            return out;
+        } catch (...) {
+            ::munmap(map, size);
+            throw;
+        }
+    }
+
+    // Streams a file, or stdin when path is "-", calling fn(const IPAddress &) for every address in
+    // file order without keeping them: memory use is one read buffer whatever the input size.
+    template<typename Fn>
+    void scan(const std::string &path, Fn &&fn) {
+        auto on_field = [&fn](const std::string_view field) { fn(parse_ip(field)); };
+        if (path == STDIN_PATH) return detail::stream_lines(STDIN_FILENO, on_field);
+        const int fd = detail::open_input(path);
+        const detail::FdGuard guard{fd};
+        detail::stream_lines(fd, on_field);
+    }
+}
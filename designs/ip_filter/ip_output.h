@@ -0,0 +1,144 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <ranges>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <vector>
+#include "ip_address.h"
+
+namespace ip_output::detail {
+    // decimal text of every octet value, padded to 4 bytes
+    struct Octet {
+        std::array<char, 4> text{};
+        std::size_t size = 0;
+    };
+
+    inline constexpr std::array<Octet, 256> OCTETS = [] {
+        std::array<Octet, 256> table{};
+        for (int v = 0; v < 256; ++v) {
+            auto &o = table[v];
+            if (v >= 100) o.text[o.size++] = static_cast<char>('0' + v / 100);
+            if (v >= 10) o.text[o.size++] = static_cast<char>('0' + v / 10 % 10);
+            o.text[o.size++] = static_cast<char>('0' + v % 10);
+        }
+        return table;
+    }();
+}
+
+// Writes addresses to a file descriptor through one large buffer instead of iostreams.
+//  - text: one dotted-quad address per line; every octet is copied from a table of the 256
+//    pre-rendered numbers, so no integer formatting happens per address;
+//  - IPv6 (IPAddress that is not IPv4-mapped) in the canonical text form of RFC 5952;
+//  - binary: network byte order, 4 bytes per IPv4Address and 16 per IPAddress;
+//  - binary_mapped: 16 bytes per record, IPv4Address too (as ::ffff:a.b.c.d) - for output that mixes
+//    both kinds, so every record has the same size;
+//  - the buffer is written with one write() call whenever it fills up, and on flush() / destruction.
+class IpWriter {
+public:
+    enum class Format { TEXT, BINARY, BINARY_MAPPED };
+
+    static constexpr std::size_t DEFAULT_BUFFER_SIZE = 1 << 20;
+
+    explicit IpWriter(const int fd, const Format format = Format::TEXT,
+                      const std::size_t buffer_size = DEFAULT_BUFFER_SIZE)
+        : fd_(fd), format_(format), buffer_(std::max(buffer_size, MAX_RECORD) + MAX_RECORD) {
+    }
+
+    IpWriter(const IpWriter &) = delete;
+    IpWriter &operator=(const IpWriter &) = delete;
+
+    ~IpWriter() {
+        try { flush(); }
+        catch (...) {
+            // destructor must not throw; the error was already reported by an explicit flush() if any
+        }
+    }
+
+    void write(const IPv4Address ip) {
+        if (format_ == Format::BINARY_MAPPED) return write(IPAddress(ip));
+        if (used_ > buffer_.size() - MAX_RECORD) flush();
+        char *p = buffer_.data() + used_;
+        if (format_ == Format::BINARY) {
+            for (int i = 0; i < IPV4_DOT_DECIMAL_NUMBER_CONSTANT; ++i) *p++ = static_cast<char>(ip.octet(i));
+        } else {
+            for (int i = 0; i < IPV4_DOT_DECIMAL_NUMBER_CONSTANT; ++i) {
+                const auto &octet = ip_output::detail::OCTETS[ip.octet(i)];
+                std::memcpy(p, octet.text.data(), 4); // fixed-size copy; only size bytes are kept
+                p += octet.size;
+                *p++ = '.';
+            }
+            p[-1] = '\n';
+        }
+        used_ = static_cast<std::size_t>(p - buffer_.data());
+    }
+
+    void write(const IPAddress &ip) {
+        if (format_ == Format::TEXT && ip.is_v4()) return write(ip.v4());
+        if (used_ > buffer_.size() - MAX_RECORD) flush();
+        char *p = buffer_.data() + used_;
+        if (format_ != Format::TEXT) {
+            for (int shift = 56; shift >= 0; shift -= 8) *p++ = static_cast<char>(ip.hi >> shift);
+            for (int shift = 56; shift >= 0; shift -= 8) *p++ = static_cast<char>(ip.lo >> shift);
+        } else {
+            p = format_ip_to(p, ip);
+            *p++ = '\n';
+        }
+        used_ = static_cast<std::size_t>(p - buffer_.data());
+    }
+
+    // Address with a hit count: "<address>\t<count>" lines, or the binary address and a u64 count.
+    template<typename Address>
+    void write(const Address &ip, const std::uint64_t count) {
+        write(ip);
+        char *p = buffer_.data() + used_;
+        if (format_ != Format::TEXT) {
+            for (int shift = 56; shift >= 0; shift -= 8) *p++ = static_cast<char>(count >> shift);
+        } else {
+            p[-1] = '\t'; // replaces the '\n' of the address line
+            char digits[20];
+            int n = 0;
+            std::uint64_t rest = count;
+            do {
+                digits[n++] = static_cast<char>('0' + rest % 10);
+                rest /= 10;
+            } while (rest != 0);
+            while (n > 0) *p++ = digits[--n];
+            *p++ = '\n';
+        }
+        used_ = static_cast<std::size_t>(p - buffer_.data());
+    }
+
+    template<std::ranges::input_range Range>
+    void write(const Range &ips) {
+        for (const auto &ip: ips) write(ip);
+    }
+
+    void flush() {
+        std::size_t off = 0;
+        while (off < used_) {
+            const ssize_t n = ::write(fd_, buffer_.data() + off, used_ - off);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                used_ = 0;
+                throw std::runtime_error(std::string("write failed: ") + std::strerror(errno));
+            }
+            off += static_cast<std::size_t>(n);
+        }
+        used_ = 0;
+    }
+
+private:
+    // longest record: an IPv6 text line with a tab and a 20-digit count, which also covers the slack
+    // of the fixed 4-byte octet copies
+    static constexpr std::size_t MAX_RECORD = IP_TEXT_MAX_SIZE + 1 + 20 + 1;
+
+    const int fd_;
+    const Format format_;
+    std::vector<char> buffer_;
+    std::size_t used_ = 0;
+};
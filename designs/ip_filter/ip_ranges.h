@@ -0,0 +1,293 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <istream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ip_address.h"
+
+// Inclusive range of addresses; a CIDR block a.b.c.d/len is the range of its network.
+struct IPv4Range {
+    IPv4Address first;
+    IPv4Address last;
+};
+
+// Same for either family (IPv4 held IPv4-mapped, see IPAddress).
+struct IPRange {
+    IPAddress first;
+    IPAddress last;
+};
+
+namespace ip_ranges::detail {
+    // Prefix length "0".."max_len"; false on anything else.
+    constexpr bool parse_prefix_length(const std::string_view text, const int max_len, int &len) {
+        if (text.empty() || text.size() > 3) return false;
+        len = 0;
+        for (const char c: text) {
+            if (c < '0' || c > '9') return false;
+            len = len * 10 + (c - '0');
+        }
+        return len <= max_len;
+    }
+
+    // Mask of the low `bits` bits of a 64-bit half (0..64).
+    constexpr std::uint64_t low_mask(const int bits) {
+        return bits <= 0 ? 0 : bits >= 64 ? ~std::uint64_t{0} : (std::uint64_t{1} << bits) - 1;
+    }
+
+    // last and next can be merged into one interval: next starts at most one past last
+    constexpr bool touches(const IPv4Address last, const IPv4Address next) {
+        return last.value == 0xFFFFFFFFu || next.value <= last.value + 1;
+    }
+
+    constexpr bool touches(const IPAddress &last, const IPAddress &next) {
+        if (last.hi == ~std::uint64_t{0} && last.lo == ~std::uint64_t{0}) return true;
+        const IPAddress after = last.lo == ~std::uint64_t{0} ? IPAddress(last.hi + 1, 0) : IPAddress(last.hi, last.lo + 1);
+        return next <= after;
+    }
+}
+
+// Parses "a.b.c.d/len", "a.b.c.d-e.f.g.h" or a single address; returns false on malformed input.
+// Host bits of a CIDR address are ignored ("10.1.2.3/8" is 10.0.0.0 - 10.255.255.255).
+constexpr bool parse_ipv4_range(const std::string_view s, IPv4Range &out) {
+    if (const auto slash = s.find('/'); slash != std::string_view::npos) {
+        IPv4Address base;
+        int len = 0;
+        if (!parse_ipv4(s.substr(0, slash), base) || !ip_ranges::detail::parse_prefix_length(s.substr(slash + 1), 32, len))
+            return false;
+        const auto host_mask = static_cast<std::uint32_t>(ip_ranges::detail::low_mask(32 - len));
+        out = {IPv4Address(base.value & ~host_mask), IPv4Address(base.value | host_mask)};
+        return true;
+    }
+    if (const auto dash = s.find('-'); dash != std::string_view::npos) {
+        IPv4Range r;
+        if (!parse_ipv4(s.substr(0, dash), r.first) || !parse_ipv4(s.substr(dash + 1), r.last) || r.last < r.first)
+            return false;
+        out = r;
+        return true;
+    }
+    IPv4Address ip;
+    if (!parse_ipv4(s, ip)) return false;
+    out = {ip, ip};
+    return true;
+}
+
+// The same forms for either family: IPv4 rules as above, IPv6 ones as "2001:db8::/32",
+// "2001:db8::1-2001:db8::ff" or a single address. An IPv4 prefix length counts IPv4 bits.
+constexpr bool parse_ip_range(const std::string_view s, IPRange &out) {
+    if (s.find(':') == std::string_view::npos) {
+        IPv4Range r;
+        if (!parse_ipv4_range(s, r)) return false;
+        out = {IPAddress(r.first), IPAddress(r.last)};
+        return true;
+    }
+    if (const auto slash = s.find('/'); slash != std::string_view::npos) {
+        IPAddress base;
+        int len = 0;
+        if (!parse_ipv6(s.substr(0, slash), base) || !ip_ranges::detail::parse_prefix_length(s.substr(slash + 1), 128, len))
+            return false;
+        const std::uint64_t hi_host = ip_ranges::detail::low_mask(64 - len);
+        const std::uint64_t lo_host = ip_ranges::detail::low_mask(128 - len);
+        out = {IPAddress(base.hi & ~hi_host, base.lo & ~lo_host), IPAddress(base.hi | hi_host, base.lo | lo_host)};
+        return true;
+    }
+    if (const auto dash = s.find('-'); dash != std::string_view::npos) {
+        IPRange r;
+        if (!parse_ipv6(s.substr(0, dash), r.first) || !parse_ipv6(s.substr(dash + 1), r.last) || r.last < r.first)
+            return false;
+        out = r;
+        return true;
+    }
+    IPAddress ip;
+    if (!parse_ipv6(s, ip)) return false;
+    out = {ip, ip};
+    return true;
+}
+
+// Set of addresses given as any number of ranges, kept as a sorted array of disjoint intervals
+// (two parallel arrays of first / last addresses): overlapping or adjacent rules are merged, so
+// they cost nothing at lookup time.
+//  - contains() binary searches the intervals;
+//  - match_runs() classifies a whole sorted pool in one merge pass, returning the matching
+//    addresses as runs (spans) of the pool instead of copies.
+// add() may be called until build(); queries are const and thread-safe afterwards.
+template<typename Address>
+class IntervalSet {
+public:
+    void add(const Address first, const Address last) {
+        pending_.push_back({first, last});
+        built_ = false;
+    }
+
+    // Merges the added ranges into disjoint intervals; required after add() before any query.
+    void build() {
+        if (built_) return;
+        for (std::size_t i = 0; i < firsts_.size(); ++i) pending_.push_back({firsts_[i], lasts_[i]});
+        std::ranges::sort(pending_, {}, &Interval::first);
+        firsts_.clear();
+        lasts_.clear();
+        for (const auto &r: pending_) {
+            if (!lasts_.empty() && ip_ranges::detail::touches(lasts_.back(), r.first)) {
+                lasts_.back() = std::max(lasts_.back(), r.last);
+                continue;
+            }
+            firsts_.push_back(r.first);
+            lasts_.push_back(r.last);
+        }
+        pending_.clear();
+        pending_.shrink_to_fit();
+        built_ = true;
+    }
+
+    // Number of disjoint intervals after merging.
+    [[nodiscard]] std::size_t interval_count() const noexcept { return firsts_.size(); }
+
+    [[nodiscard]] bool contains(const Address &ip) const {
+        check_built();
+        return contains_within(ip, 0, lasts_.size());
+    }
+
+    // Matching addresses of a pool sorted in descending order, as runs of that pool (in pool order).
+    // One merge pass; the pool is binary searched, so sparse matches cost O(intervals * log(pool)).
+    [[nodiscard]] std::vector<std::span<const Address> > match_runs(const std::span<const Address> sorted_desc) const {
+        check_built();
+        std::vector<std::span<const Address> > runs;
+        auto it = sorted_desc.begin();
+        // intervals from the highest down, in step with the pool
+        for (std::size_t j = firsts_.size(); j-- > 0 && it != sorted_desc.end();) {
+            it = std::partition_point(it, sorted_desc.end(), [&](const Address &ip) { return ip > lasts_[j]; });
+            const auto run_end = std::partition_point(it, sorted_desc.end(),
+                                                      [&](const Address &ip) { return ip >= firsts_[j]; });
+            if (run_end != it) runs.emplace_back(it, run_end);
+            it = run_end;
+        }
+        return runs;
+    }
+
+protected:
+    struct Interval {
+        Address first;
+        Address last;
+    };
+
+    void check_built() const {
+        if (!built_) throw std::logic_error("IntervalSet: build() must be called after add()");
+    }
+
+    // The interval holding ip, if any, is the first one ending at or after it; it is searched
+    // among intervals [lo, hi) only.
+    [[nodiscard]] bool contains_within(const Address &ip, const std::size_t lo, const std::size_t hi) const {
+        const auto it = std::lower_bound(lasts_.begin() + static_cast<std::ptrdiff_t>(lo),
+                                         lasts_.begin() + static_cast<std::ptrdiff_t>(hi), ip);
+        if (it == lasts_.end()) return false;
+        return firsts_[static_cast<std::size_t>(it - lasts_.begin())] <= ip;
+    }
+
+    std::vector<Interval> pending_;  // added since the last build()
+    std::vector<Address> firsts_;    // disjoint intervals, ascending
+    std::vector<Address> lasts_;
+    bool built_ = true;
+};
+
+using IPv6RangeSet = IntervalSet<IPAddress>;
+
+// IPv4 CIDR blocks / ranges, for membership tests at scale: on top of IntervalSet a directory over
+// the top 16 bits narrows every lookup to the intervals of one /16 before the binary search, so
+// lookups stay a handful of steps even for 100k+ ranges.
+class IPv4RangeSet : public IntervalSet<IPv4Address> {
+public:
+    void add(const IPv4Range r) { IntervalSet::add(r.first, r.last); }
+
+    void build() {
+        if (built_) return;
+        IntervalSet::build();
+        // directory_[k]: first interval that ends at or after the start of /16 number k
+        directory_.assign(DIRECTORY_SIZE + 1, static_cast<std::uint32_t>(lasts_.size()));
+        std::size_t i = 0;
+        for (std::uint32_t k = 0; k < DIRECTORY_SIZE; ++k) {
+            while (i < lasts_.size() && lasts_[i].value < k << 16) ++i;
+            directory_[k] = static_cast<std::uint32_t>(i);
+        }
+    }
+
+    [[nodiscard]] bool contains(const IPv4Address ip) const {
+        check_built();
+        if (lasts_.empty()) return false;
+        const std::uint32_t k = ip.value >> 16;
+        return contains_within(ip, directory_[k], std::min<std::size_t>(directory_[k + 1] + 1, lasts_.size()));
+    }
+
+    // Batch classification in any order: matches[i] is set to whether addresses[i] is in the set.
+    void classify(const std::span<const IPv4Address> addresses, std::span<bool> matches) const {
+        if (matches.size() != addresses.size()) throw std::invalid_argument("classify: size mismatch");
+        for (std::size_t i = 0; i < addresses.size(); ++i) matches[i] = contains(addresses[i]);
+    }
+
+private:
+    static constexpr std::uint32_t DIRECTORY_SIZE = 1 << 16;
+
+    std::vector<std::uint32_t> directory_;
+};
+
+// Rules of both families from one file, split by family: IPv4 pools are matched against v4 only,
+// IPv6 pools against v6 only. An IPv6 rule reaching into the IPv4-mapped block (::ffff:0:0/96)
+// also adds that part to v4.
+struct IPRangeSets {
+    IPv4RangeSet v4;
+    IPv6RangeSet v6;
+
+    void add(const IPRange &r) {
+        v6.add(r.first, r.last);
+        const IPAddress mapped_first(IPv4Address(0));
+        const IPAddress mapped_last(IPv4Address(0xFFFFFFFFu));
+        if (r.last < mapped_first || r.first > mapped_last) return;
+        v4.add({std::max(r.first, mapped_first).v4(), std::min(r.last, mapped_last).v4()});
+    }
+
+    void build() {
+        v4.build();
+        v6.build();
+    }
+
+    // One rule per line, '#' starts a comment; blank lines are skipped.
+    static IPRangeSets load(std::istream &in) {
+        IPRangeSets sets;
+        std::string line;
+        for (std::size_t n = 1; std::getline(in, line); ++n) {
+            std::string_view rule = line;
+            rule = rule.substr(0, rule.find('#'));
+            while (!rule.empty() && (rule.back() == ' ' || rule.back() == '\t' || rule.back() == '\r')) rule.remove_suffix(1);
+            while (!rule.empty() && (rule.front() == ' ' || rule.front() == '\t')) rule.remove_prefix(1);
+            if (rule.empty()) continue;
+            IPRange r;
+            if (!parse_ip_range(rule, r))
+                throw std::invalid_argument("Invalid range on line " + std::to_string(n) + ": " + std::string(rule));
+            sets.add(r);
+        }
+        sets.build();
+        return sets;
+    }
+};
+
+static_assert([] {
+    IPv4Range r;
+    return parse_ipv4_range("10.1.2.3/8", r) && r.first == IPv4Address(10, 0, 0, 0) &&
+           r.last == IPv4Address(10, 255, 255, 255);
+}());
+static_assert([] {
+    IPv4Range r;
+    return parse_ipv4_range("0.0.0.0/0", r) && r.first.value == 0 && r.last.value == 0xFFFFFFFFu &&
+           !parse_ipv4_range("1.2.3.4/33", r) && !parse_ipv4_range("1.2.3.4-1.2.3.3", r);
+}());
+static_assert([] {
+    IPRange r;
+    return parse_ip_range("2001:db8::1/32", r) && r.first == IPAddress(0x2001'0db8'0000'0000, 0) &&
+           r.last == IPAddress(0x2001'0db8'ffff'ffff, ~std::uint64_t{0}) &&
+           parse_ip_range("::/0", r) && r.first == IPAddress() && r.last == IPAddress(~std::uint64_t{0}, ~std::uint64_t{0}) &&
+           parse_ip_range("::1/128", r) && r.first == r.last &&
+           parse_ip_range("10.0.0.0/8", r) && r.first.is_v4() && r.last == IPAddress(IPv4Address(10, 255, 255, 255)) &&
+           !parse_ip_range("::/129", r);
+}());
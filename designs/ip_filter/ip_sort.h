@@ -0,0 +1,105 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "ip_address.h"
+
+// Sorting of packed addresses in descending order (the order ip_filter prints them in).
+//  - small inputs: comparison sort;
+//  - otherwise LSD radix sort, one pass per byte of the packed key; a pass is skipped when all
+//    addresses share that byte. No comparisons and no allocation besides one scratch buffer;
+//  - large inputs: the addresses are first split by their first octet (one MSD pass), then the
+//    256 independent buckets are radix sorted by worker threads.
+namespace ip_sort {
+    constexpr std::size_t COMPARISON_SORT_LIMIT = 256;
+    constexpr std::size_t PARALLEL_SORT_THRESHOLD = 1 << 20;
+
+    namespace detail {
+        // Byte k (0 = least significant) of the packed key, flipped so that ascending buckets
+        // give descending addresses.
+        constexpr std::size_t bucket(const IPv4Address ip, const int k) {
+            return 255 - ((ip.value >> (8 * k)) & 0xFF);
+        }
+
+        constexpr std::size_t bucket(const IPAddress &ip, const int k) {
+            const std::uint64_t half = k < 8 ? ip.lo : ip.hi;
+            return 255 - ((half >> (8 * (k % 8))) & 0xFF);
+        }
+
+        // LSD radix sort of data by its key bytes 0..key_bytes-1, using scratch of the same size.
+        // The result ends up in data.
+        template<typename Address>
+        void radix_sort(std::span<Address> data, std::span<Address> scratch, const int key_bytes) {
+            if (data.size() <= COMPARISON_SORT_LIMIT) {
+                std::ranges::sort(data, std::greater{});
+                return;
+            }
+            std::span<Address> from = data;
+            std::span<Address> to = scratch;
+            for (int k = 0; k < key_bytes; ++k) {
+                std::array<std::size_t, 256> offsets{};
+                for (const auto &ip: from) ++offsets[bucket(ip, k)];
+                if (std::ranges::find(offsets, from.size()) != offsets.end()) continue; // all in one bucket
+                std::size_t sum = 0;
+                for (auto &o: offsets) sum += std::exchange(o, sum);
+                for (const auto &ip: from) to[offsets[bucket(ip, k)]++] = ip;
+                std::swap(from, to);
+            }
+            if (from.data() != data.data()) std::ranges::copy(from, data.begin());
+        }
+    }
+
+    inline std::size_t default_workers() {
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // Sorts in descending order on the calling thread.
+    inline void sort_descending(std::vector<IPv4Address> &ips) {
+        std::vector<IPv4Address> scratch(ips.size());
+        detail::radix_sort<IPv4Address>(ips, scratch, 4);
+    }
+
+    // IPv6 (128-bit keys): bytes equal in all addresses - typically most of a shared prefix - cost
+    // one counting pass each and no scatter.
+    inline void sort_descending(std::vector<IPAddress> &ips) {
+        std::vector<IPAddress> scratch(ips.size());
+        detail::radix_sort<IPAddress>(ips, scratch, 16);
+    }
+
+    // Sorts in descending order with up to `workers` threads; inputs below PARALLEL_SORT_THRESHOLD
+    // (or a single worker) are sorted on the calling thread.
+    inline void parallel_sort_descending(std::vector<IPv4Address> &ips, std::size_t workers = default_workers()) {
+        if (workers <= 1 || ips.size() < PARALLEL_SORT_THRESHOLD) return sort_descending(ips);
+
+        // MSD pass: scatter into scratch grouped by the first octet, largest first
+        std::vector<IPv4Address> scratch(ips.size());
+        std::array<std::size_t, 257> bounds{};
+        for (const auto ip: ips) ++bounds[detail::bucket(ip, 3) + 1];
+        for (std::size_t b = 1; b < bounds.size(); ++b) bounds[b] += bounds[b - 1];
+        std::array<std::size_t, 256> next{};
+        std::copy_n(bounds.begin(), next.size(), next.begin());
+        for (const auto ip: ips) scratch[next[detail::bucket(ip, 3)]++] = ip;
+
+        // buckets are independent: each is sorted in scratch, using the same range of ips as its buffer
+        std::atomic<std::size_t> next_bucket{0};
+        auto work = [&] {
+            for (std::size_t b; (b = next_bucket.fetch_add(1, std::memory_order_relaxed)) < 256;) {
+                const std::size_t size = bounds[b + 1] - bounds[b];
+                detail::radix_sort(std::span(scratch).subspan(bounds[b], size),
+                                   std::span(ips).subspan(bounds[b], size), 3);
+            }
+        };
+        std::vector<std::jthread> threads;
+        for (std::size_t i = 1; i < workers; ++i) threads.emplace_back(work);
+        work();
+        threads.clear(); // joins
+        ips.swap(scratch);
+    }
+}
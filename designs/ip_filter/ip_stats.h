@@ -0,0 +1,212 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+#include "ip_address.h"
+
+// Per-address hit counts and frequency reports.
+//  - exact: on a sorted pool equal addresses are adjacent, so counting is one run-length pass
+//    (sort-based reduction, no hash table); top-K is a partial sort of the distinct addresses;
+//  - approximate, for streams that do not fit in memory, in fixed memory:
+//      HyperLogLog      - number of distinct addresses (~0.8% standard error with 2^14 registers),
+//      CountMinSketch   - upper-bound frequency estimate of any address,
+//      SpaceSaving      - the K most frequent addresses (heavy hitters) with their counts.
+namespace ip_stats {
+    template<typename Address>
+    struct Counted {
+        Address address;
+        std::uint64_t count = 0;
+    };
+
+    // Distinct addresses with their counts, in pool order. The pool must be sorted (either direction).
+    template<typename Address>
+    std::vector<Counted<Address> > count_sorted(const std::span<const Address> sorted) {
+        std::vector<Counted<Address> > out;
+        for (std::size_t i = 0; i < sorted.size();) {
+            std::size_t j = i + 1;
+            while (j < sorted.size() && sorted[j] == sorted[i]) ++j;
+            out.push_back({sorted[i], j - i});
+            i = j;
+        }
+        return out;
+    }
+
+    // Most frequent first; equal counts by descending address, so the report is deterministic.
+    template<typename Address>
+    constexpr bool more_frequent(const Counted<Address> &a, const Counted<Address> &b) {
+        return a.count != b.count ? a.count > b.count : a.address > b.address;
+    }
+
+    // Keeps the k most frequent entries of counts, most frequent first.
+    template<typename Address>
+    void top_k(std::vector<Counted<Address> > &counts, const std::size_t k) {
+        const auto keep = static_cast<std::ptrdiff_t>(std::min(k, counts.size()));
+        std::partial_sort(counts.begin(), counts.begin() + keep, counts.end(), more_frequent<Address>);
+        counts.resize(static_cast<std::size_t>(keep));
+    }
+
+    // 64-bit hash of a 128-bit key (two rounds of the murmur3 / splitmix finalizer).
+    constexpr std::uint64_t hash(const IPAddress &ip, const std::uint64_t seed = 0) {
+        auto mix = [](std::uint64_t x) {
+            x ^= x >> 33;
+            x *= 0xff51afd7ed558ccdULL;
+            x ^= x >> 33;
+            x *= 0xc4ceb9fe1a85ec53ULL;
+            x ^= x >> 33;
+            return x;
+        };
+        return mix(mix(ip.hi ^ seed) ^ ip.lo);
+    }
+
+    class HyperLogLog {
+    public:
+        // 2^precision one-byte registers; precision 4..18
+        explicit HyperLogLog(const int precision = 14) : precision_(precision) {
+            if (precision < 4 || precision > 18) throw std::invalid_argument("HyperLogLog precision must be 4..18");
+            registers_.assign(std::size_t{1} << precision, 0);
+        }
+
+        void add(const IPAddress &ip) {
+            const std::uint64_t h = hash(ip);
+            const std::size_t index = h >> (64 - precision_);
+            const std::uint64_t rest = h << precision_ | std::uint64_t{1} << (precision_ - 1); // bounds the rank
+            const auto rank = static_cast<std::uint8_t>(std::countl_zero(rest) + 1);
+            registers_[index] = std::max(registers_[index], rank);
+        }
+
+        [[nodiscard]] double estimate() const {
+            const auto m = static_cast<double>(registers_.size());
+            double sum = 0;
+            std::size_t zeros = 0;
+            for (const auto r: registers_) {
+                sum += std::ldexp(1.0, -r);
+                zeros += r == 0;
+            }
+            const double alpha = 0.7213 / (1 + 1.079 / m);
+            const double raw = alpha * m * m / sum;
+            // small cardinalities: linear counting over the empty registers is more accurate
+            if (raw <= 2.5 * m && zeros > 0) return m * std::log(m / static_cast<double>(zeros));
+            return raw;
+        }
+
+    private:
+        int precision_;
+        std::vector<std::uint8_t> registers_;
+    };
+
+    // depth rows of width counters; an estimate exceeds the true count by at most
+    // e / width * (total count) with probability 1 - exp(-depth).
+    class CountMinSketch {
+    public:
+        explicit CountMinSketch(const std::size_t width = 1 << 16, const std::size_t depth = 4)
+            : width_(width), depth_(depth), counters_(width * depth, 0) {
+            if (width == 0 || depth == 0) throw std::invalid_argument("CountMinSketch needs a non-zero size");
+        }
+
+        void add(const IPAddress &ip, const std::uint64_t count = 1) {
+            for (std::size_t row = 0; row < depth_; ++row) counters_[row * width_ + column(ip, row)] += count;
+        }
+
+        [[nodiscard]] std::uint64_t estimate(const IPAddress &ip) const {
+            std::uint64_t best = UINT64_MAX;
+            for (std::size_t row = 0; row < depth_; ++row) best = std::min(best, counters_[row * width_ + column(ip, row)]);
+            return best;
+        }
+
+    private:
+        [[nodiscard]] std::size_t column(const IPAddress &ip, const std::size_t row) const {
+            return hash(ip, row + 1) % width_;
+        }
+
+        std::size_t width_;
+        std::size_t depth_;
+        std::vector<std::uint64_t> counters_;
+    };
+
+    // Space-Saving (Metwally et al.): tracks `capacity` addresses; an untracked address replaces the
+    // one with the smallest count and inherits that count as its possible overestimation (error).
+    // Every address seen more than total / capacity times is guaranteed to be tracked.
+    // The tracked entries form a min-heap on count, with a hash map from address to heap slot.
+    class SpaceSaving {
+    public:
+        struct Entry {
+            IPAddress address;
+            std::uint64_t count = 0;
+            std::uint64_t error = 0; // count - error is a lower bound of the true count
+        };
+
+        explicit SpaceSaving(const std::size_t capacity) : capacity_(capacity) {
+            if (capacity == 0) throw std::invalid_argument("SpaceSaving capacity must be positive");
+            heap_.reserve(capacity);
+            slots_.reserve(capacity * 2);
+        }
+
+        void add(const IPAddress &ip) {
+            if (const auto it = slots_.find(ip); it != slots_.end()) {
+                ++heap_[it->second].count;
+                sift_down(it->second);
+                return;
+            }
+            if (heap_.size() < capacity_) {
+                heap_.push_back({ip, 1, 0});
+                slots_[ip] = heap_.size() - 1;
+                sift_up(heap_.size() - 1);
+                return;
+            }
+            // replace the minimum
+            Entry &min = heap_.front();
+            slots_.erase(min.address);
+            min = {ip, min.count + 1, min.count};
+            slots_[ip] = 0;
+            sift_down(0);
+        }
+
+        // Tracked addresses, most frequent first.
+        [[nodiscard]] std::vector<Entry> entries() const {
+            auto out = heap_;
+            std::ranges::sort(out, [](const Entry &a, const Entry &b) {
+                return a.count != b.count ? a.count > b.count : a.address > b.address;
+            });
+            return out;
+        }
+
+    private:
+        struct Hash {
+            std::size_t operator()(const IPAddress &ip) const { return static_cast<std::size_t>(hash(ip)); }
+        };
+
+        void swap_slots(const std::size_t a, const std::size_t b) {
+            std::swap(heap_[a], heap_[b]);
+            slots_[heap_[a].address] = a;
+            slots_[heap_[b].address] = b;
+        }
+
+        void sift_up(std::size_t i) {
+            while (i > 0 && heap_[(i - 1) / 2].count > heap_[i].count) {
+                swap_slots(i, (i - 1) / 2);
+                i = (i - 1) / 2;
+            }
+        }
+
+        void sift_down(std::size_t i) {
+            for (;;) {
+                std::size_t smallest = i;
+                for (const std::size_t child: {2 * i + 1, 2 * i + 2})
+                    if (child < heap_.size() && heap_[child].count < heap_[smallest].count) smallest = child;
+                if (smallest == i) return;
+                swap_slots(i, smallest);
+                i = smallest;
+            }
+        }
+
+        std::size_t capacity_;
+        std::vector<Entry> heap_;
+        std::unordered_map<IPAddress, std::size_t, Hash> slots_;
+    };
+}
@@ -0,0 +1,132 @@
+// ip_sort_bench - compares sorting of IPv4 addresses in descending order:
+//   legacy   - the original representation (vector of 4 octet strings) and comparator building
+//              two zero-padded strings per comparison;
+//   std_sort - std::ranges::sort of packed addresses with std::greater;
+//   radix    - ip_sort::sort_descending;
+//   parallel - ip_sort::parallel_sort_descending.
+// Addresses are random, or read from the first column of a TSV file (--file). All results are checked
+// to be identical.
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "ip_address.h"
+#include "ip_sort.h"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+    using LegacyAddress = std::vector<std::string>;
+
+    double seconds_since(const Clock::time_point start) {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    LegacyAddress to_legacy(const IPv4Address ip) {
+        LegacyAddress r;
+        for (int i = 0; i < IPV4_DOT_DECIMAL_NUMBER_CONSTANT; ++i) r.push_back(std::to_string(ip.octet(i)));
+        return r;
+    }
+
+    // the comparator ip_filter used before addresses were packed
+    void legacy_sort(std::vector<LegacyAddress> &pool) {
+        std::ranges::sort(pool, [](const auto &a, const auto &b) {
+            std::string result_a;
+            std::string result_b;
+            for (const auto &a_el: a) {
+                result_a += std::string(IPV4_DOT_DECIMAL_DIGIT_SIZE_LIMIT - std::size(a_el), '0') + a_el + ".";
+            }
+            for (const auto &b_el: b) {
+                result_b += std::string(IPV4_DOT_DECIMAL_DIGIT_SIZE_LIMIT - std::size(b_el), '0') + b_el + ".";
+            }
+            return (result_a > result_b);
+        });
+    }
+
+    void report(const std::string &name, const std::size_t n, const double secs, const double baseline) {
+        std::cout << std::left << std::setw(10) << name << std::right << std::fixed << std::setprecision(3)
+                << std::setw(10) << secs * 1000 << " ms" << std::setprecision(1)
+                << std::setw(10) << static_cast<double>(n) / secs / 1e6 << " M/s"
+                << std::setw(9) << baseline / secs << "x\n";
+    }
+}
+
+int main(const int argc, char *argv[]) {
+    std::size_t count = 4'000'000;
+    std::size_t legacy_limit = 1'000'000; // the legacy comparator is far slower; it sorts a prefix of the input
+    std::string file;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const std::string key = argv[i];
+        if (key == "--count") count = std::stoul(argv[i + 1]);
+        else if (key == "--legacy-limit") legacy_limit = std::stoul(argv[i + 1]);
+        else if (key == "--file") file = argv[i + 1];
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--count n] [--legacy-limit n] [--file addresses.tsv]\n";
+            return 1;
+        }
+    }
+
+    std::vector<IPv4Address> input;
+    try {
+        if (!file.empty()) {
+            std::ifstream in(file);
+            if (!in) throw std::runtime_error("could not open " + file);
+            for (std::string line; std::getline(in, line);) input.push_back(parse_ipv4(line.substr(0, line.find('\t'))));
+        } else {
+            std::mt19937 rng(42);
+            input.resize(count);
+            for (auto &ip: input) ip = IPv4Address(static_cast<std::uint32_t>(rng()));
+        }
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << '\n';
+        return 1;
+    }
+    std::cout << input.size() << " addresses, " << ip_sort::default_workers() << " threads\n";
+
+    auto expected = input;
+    auto start = Clock::now();
+    std::ranges::sort(expected, std::greater{});
+    const double std_secs = seconds_since(start);
+
+    auto radix = input;
+    start = Clock::now();
+    ip_sort::sort_descending(radix);
+    const double radix_secs = seconds_since(start);
+
+    auto parallel = input;
+    start = Clock::now();
+    ip_sort::parallel_sort_descending(parallel);
+    const double parallel_secs = seconds_since(start);
+
+    const std::size_t legacy_n = std::min(legacy_limit, input.size());
+    std::vector<LegacyAddress> legacy;
+    legacy.reserve(legacy_n);
+    for (std::size_t i = 0; i < legacy_n; ++i) legacy.push_back(to_legacy(input[i]));
+    start = Clock::now();
+    legacy_sort(legacy);
+    const double legacy_secs = seconds_since(start);
+
+    // same order everywhere (the legacy result is checked against a packed sort of the same prefix)
+    std::vector prefix(input.begin(), input.begin() + static_cast<std::ptrdiff_t>(legacy_n));
+    ip_sort::sort_descending(prefix);
+    bool same = radix == expected && parallel == expected;
+    for (std::size_t i = 0; same && i < legacy_n; ++i) same = legacy[i] == to_legacy(prefix[i]);
+    if (!same) {
+        std::cerr << "sort results differ\n";
+        return 1;
+    }
+
+    // speed-ups are relative to the legacy comparator, scaled to the full input size by n log n
+    const auto n_log_n = [](const double n) { return n > 1 ? n * std::log2(n) : 1.0; };
+    const double legacy_full = legacy_secs * n_log_n(static_cast<double>(input.size())) /
+                               n_log_n(static_cast<double>(std::max<std::size_t>(legacy_n, 1)));
+    std::cout << "legacy comparator on " << legacy_n << " addresses: " << std::fixed << std::setprecision(3)
+            << legacy_secs * 1000 << " ms (" << legacy_full * 1000 << " ms estimated for all)\n";
+    report("std_sort", input.size(), std_secs, legacy_full);
+    report("radix", input.size(), radix_secs, legacy_full);
+    report("parallel", input.size(), parallel_secs, legacy_full);
+    return 0;
+}
@@ -0,0 +1,249 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace sparse_matrix {
+    // Read-only Compressed Sparse Row (CSR) form of a sparse matrix, produced by freeze() of the map-based
+    // matrices once they are filled in. Cells live in contiguous arrays instead of one map node each:
+    //  - row_ids_     - non-empty rows, ascending. Row numbers are arbitrary std::size_t, so only rows that
+    //                   have cells get a slot (doubly compressed rows);
+    //  - row_offsets_ - cells of row_ids_[i] are at positions row_offsets_[i] .. row_offsets_[i + 1] - 1;
+    //  - columns_, values_ - column and value of every cell, row by row, columns ascending.
+    // Reading a cell is two binary searches; iteration is a linear scan in row-major order.
+    template<class T>
+    class CompressedSparseMatrix {
+    public:
+        struct Entry {
+            std::size_t x;
+            std::size_t y;
+            T value;
+        };
+
+        CompressedSparseMatrix() = default;
+
+        // cells in any order with unique coordinates; cells holding the default value are dropped
+        CompressedSparseMatrix(const T &default_value, std::vector<Entry> entries) : def_(default_value) {
+            std::erase_if(entries, [this](const Entry &e) { return e.value == def_; });
+            auto row_major = [](const Entry &a, const Entry &b) { return a.x != b.x ? a.x < b.x : a.y < b.y; };
+            // ordered maps already hand the cells over sorted
+            if (!std::ranges::is_sorted(entries, row_major)) std::ranges::sort(entries, row_major);
+
+            columns_.reserve(entries.size());
+            values_.reserve(entries.size());
+            for (const auto &[x, y, value]: entries) {
+                if (row_ids_.empty() || row_ids_.back() != x) {
+                    if (!row_ids_.empty()) row_offsets_.push_back(columns_.size());
+                    row_ids_.push_back(x);
+                }
+                columns_.push_back(y);
+                values_.push_back(value);
+            }
+            if (!row_ids_.empty()) row_offsets_.push_back(columns_.size());
+            column_count_ = columns_.empty() ? 0 : std::ranges::max(columns_) + 1;
+        }
+
+        // arrays already in the layout above (as built by the multiplication kernels); taken as they are
+        CompressedSparseMatrix(const T &default_value, std::vector<std::size_t> row_ids,
+                               std::vector<std::size_t> row_offsets, std::vector<std::size_t> columns,
+                               std::vector<T> values)
+            : def_(default_value), row_ids_(std::move(row_ids)), row_offsets_(std::move(row_offsets)),
+              columns_(std::move(columns)), values_(std::move(values)),
+              column_count_(columns_.empty() ? 0 : std::ranges::max(columns_) + 1) {
+        }
+
+        // number of stored (non-default) cells
+        [[nodiscard]] std::size_t size() const noexcept { return values_.size(); }
+
+        [[nodiscard]] const T &default_value() const noexcept { return def_; }
+
+        // bounding dimensions: one past the largest row / column that has a cell
+        [[nodiscard]] std::size_t row_count() const noexcept { return row_ids_.empty() ? 0 : row_ids_.back() + 1; }
+        [[nodiscard]] std::size_t column_count() const noexcept { return column_count_; }
+
+        // raw CSR arrays, for kernels that walk the matrix row by row
+        [[nodiscard]] std::span<const std::size_t> row_ids() const noexcept { return row_ids_; }
+        [[nodiscard]] std::span<const std::size_t> row_offsets() const noexcept { return row_offsets_; }
+        [[nodiscard]] std::span<const std::size_t> columns() const noexcept { return columns_; }
+        [[nodiscard]] std::span<const T> values() const noexcept { return values_; }
+
+        // cells of one row; matrix[r][c] reads like on the map-based matrices
+        class RowView {
+            std::span<const std::size_t> columns_;
+            std::span<const T> values_;
+            const T *def_;
+
+        public:
+            RowView(const std::span<const std::size_t> columns, const std::span<const T> values, const T &def)
+                : columns_(columns), values_(values), def_(&def) {
+            }
+
+            T operator[](const std::size_t col) const {
+                const auto it = std::ranges::lower_bound(columns_, col);
+                if (it != columns_.end() && *it == col) return values_[static_cast<std::size_t>(it - columns_.begin())];
+                return *def_;
+            }
+
+            [[nodiscard]] std::size_t size() const noexcept { return values_.size(); }
+            [[nodiscard]] std::span<const std::size_t> columns() const noexcept { return columns_; }
+            [[nodiscard]] std::span<const T> values() const noexcept { return values_; }
+        };
+
+        // the row is looked up once; matrix[r][c1], matrix[r][c2] ... only search its columns
+        RowView operator[](const std::size_t row) const {
+            const auto it = std::ranges::lower_bound(row_ids_, row);
+            if (it == row_ids_.end() || *it != row) return RowView({}, {}, def_);
+            const auto slot = static_cast<std::size_t>(it - row_ids_.begin());
+            const std::size_t first = row_offsets_[slot];
+            const std::size_t count = row_offsets_[slot + 1] - first;
+            return RowView(std::span(columns_).subspan(first, count), std::span(values_).subspan(first, count), def_);
+        }
+
+        class iterator {
+            const CompressedSparseMatrix *parent_ = nullptr;
+            std::size_t slot_ = 0; // index of the current row in row_ids_
+            std::size_t pos_ = 0;  // index of the current cell
+
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = Entry;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const Entry *;
+            using reference = const Entry; // cells are not stored as Entry, so returned by value
+
+            iterator() = default;
+
+            iterator(const CompressedSparseMatrix *p, const std::size_t slot, const std::size_t pos)
+                : parent_(p), slot_(slot), pos_(pos) {
+            }
+
+            reference operator*() const {
+                return Entry{parent_->row_ids_[slot_], parent_->columns_[pos_], parent_->values_[pos_]};
+            }
+
+            iterator &operator++() {
+                if (++pos_ == parent_->row_offsets_[slot_ + 1]) ++slot_;
+                return *this;
+            }
+
+            iterator operator++(int) {
+                iterator old = *this;
+                ++*this;
+                return old;
+            }
+
+            bool operator==(const iterator &other) const { return pos_ == other.pos_; }
+            bool operator!=(const iterator &other) const { return !(*this == other); }
+        };
+
+        iterator begin() const noexcept { return iterator(this, 0, 0); }
+        iterator end() const noexcept { return iterator(this, row_ids_.size(), values_.size()); }
+
+        // Cells of a rectangle, row-major: first_row <= row <= last_row, first_col <= column <= last_col.
+        // Every non-empty row in the range costs a binary search for the column bounds, then its cells are
+        // read in place. With transposed, x and y of the entries are swapped - for an index that holds the
+        // transposed matrix (columns as rows). Valid as long as the matrix it reads.
+        class Slice {
+        public:
+            class iterator {
+                const CompressedSparseMatrix *parent_ = nullptr;
+                std::size_t last_slot_ = 0; // one past the last row slot
+                std::size_t first_col_ = 0, last_col_ = 0;
+                bool transposed_ = false;
+                std::size_t slot_ = 0, pos_ = 0, pos_end_ = 0; // current row slot and its cells in the range
+
+                // moves to the first row from slot_ on that has cells in the column range
+                void settle() {
+                    const std::size_t *columns = parent_->columns_.data();
+                    for (; slot_ < last_slot_; ++slot_) {
+                        const std::size_t *first = columns + parent_->row_offsets_[slot_];
+                        const std::size_t *last = columns + parent_->row_offsets_[slot_ + 1];
+                        const std::size_t *lo = std::lower_bound(first, last, first_col_);
+                        const std::size_t *hi = std::upper_bound(lo, last, last_col_);
+                        if (lo != hi) {
+                            pos_ = static_cast<std::size_t>(lo - columns);
+                            pos_end_ = static_cast<std::size_t>(hi - columns);
+                            return;
+                        }
+                    }
+                    pos_ = pos_end_ = 0;
+                }
+
+            public:
+                using iterator_category = std::forward_iterator_tag;
+                using value_type = Entry;
+                using difference_type = std::ptrdiff_t;
+                using pointer = const Entry *;
+                using reference = const Entry;
+
+                iterator() = default;
+
+                iterator(const Slice &s, const std::size_t slot)
+                    : parent_(s.parent_), last_slot_(s.last_slot_), first_col_(s.first_col_), last_col_(s.last_col_),
+                      transposed_(s.transposed_), slot_(slot) {
+                    settle();
+                }
+
+                reference operator*() const {
+                    const std::size_t row = parent_->row_ids_[slot_];
+                    const std::size_t column = parent_->columns_[pos_];
+                    if (transposed_) return Entry{column, row, parent_->values_[pos_]};
+                    return Entry{row, column, parent_->values_[pos_]};
+                }
+
+                iterator &operator++() {
+                    if (++pos_ == pos_end_) {
+                        ++slot_;
+                        settle();
+                    }
+                    return *this;
+                }
+
+                iterator operator++(int) {
+                    iterator old = *this;
+                    ++*this;
+                    return old;
+                }
+
+                bool operator==(const iterator &other) const { return slot_ == other.slot_ && pos_ == other.pos_; }
+                bool operator!=(const iterator &other) const { return !(*this == other); }
+            };
+
+            Slice(const CompressedSparseMatrix *p, const std::size_t first_slot, const std::size_t last_slot,
+                  const std::size_t first_col, const std::size_t last_col, const bool transposed)
+                : parent_(p), first_slot_(first_slot), last_slot_(last_slot), first_col_(first_col),
+                  last_col_(last_col), transposed_(transposed) {
+            }
+
+            iterator begin() const { return iterator(*this, first_slot_); }
+            iterator end() const { return iterator(*this, last_slot_); }
+            [[nodiscard]] bool empty() const { return begin() == end(); }
+
+        private:
+            const CompressedSparseMatrix *parent_;
+            std::size_t first_slot_, last_slot_;
+            std::size_t first_col_, last_col_;
+            bool transposed_;
+        };
+
+        Slice slice(const std::size_t first_row, const std::size_t last_row, const std::size_t first_col,
+                    const std::size_t last_col, const bool transposed = false) const {
+            const auto slot = [this](const auto it) { return static_cast<std::size_t>(it - row_ids_.begin()); };
+            const std::size_t first_slot = slot(std::ranges::lower_bound(row_ids_, first_row));
+            std::size_t last_slot = slot(std::ranges::upper_bound(row_ids_, last_row));
+            if (first_row > last_row || first_col > last_col) last_slot = first_slot;
+            return Slice(this, first_slot, last_slot, first_col, last_col, transposed);
+        }
+
+    private:
+        T def_{};
+        std::vector<std::size_t> row_ids_;
+        std::vector<std::size_t> row_offsets_{0};
+        std::vector<std::size_t> columns_;
+        std::vector<T> values_;
+        std::size_t column_count_ = 0;
+    };
+}
@@ -0,0 +1,224 @@
+// sparse_bench - compares the CSR multiplication kernels (sparse_kernels.h) with dense row-major loops:
+//   spmv   - y = A * x, sparse_matrix::multiply on one thread and on all threads vs a dense matrix-vector loop;
+//   spgemm - C = A * A, same, vs a dense i-k-j matrix product (on a smaller matrix, --gemm-n);
+//   access - random writes and reads through matrix[r][c], nested hash maps vs the flat hash storage.
+// Sparsity patterns:
+//   stencil  - 5-point Laplacian of a square grid (PDE solvers): 5 cells per row around the diagonal;
+//   random   - uniformly scattered cells, --density of all;
+//   powerlaw - row lengths drawn from a Zipf-like distribution (graphs): a few very long rows.
+// Sparse and dense results are checked to be equal. The all-threads rows ask for default_workers()
+// explicitly, so they are threaded even below PARALLEL_MULTIPLY_THRESHOLD (where AUTO_WORKERS would not be).
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include "sparse_kernels.h"
+#include "sparse_matrix_template.h"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+    using Dense = std::vector<double>; // n * n, row-major
+
+    // best of `repeat` runs, in seconds
+    double best_time(const int repeat, const std::function<void()> &run) {
+        double best = 1e300;
+        for (int i = 0; i < repeat; ++i) {
+            const auto start = Clock::now();
+            run();
+            best = std::min(best, std::chrono::duration<double>(Clock::now() - start).count());
+        }
+        return best;
+    }
+
+    // fills the sparse matrix through the proxy API and keeps a dense copy
+    void set(SparseMatrix<double> &sparse, Dense &dense, const std::size_t n, const std::size_t r,
+             const std::size_t c, const double v) {
+        sparse[r][c] = v;
+        dense[r * n + c] = v;
+    }
+
+    void make_pattern(const std::string &pattern, const std::size_t n, const double density,
+                      SparseMatrix<double> &sparse, Dense &dense) {
+        std::mt19937_64 rng(42);
+        std::uniform_real_distribution value(-1.0, 1.0);
+        if (pattern == "stencil") {
+            const auto side = static_cast<std::size_t>(std::sqrt(static_cast<double>(n)));
+            for (std::size_t r = 0; r < side * side; ++r) {
+                set(sparse, dense, n, r, r, 4.0);
+                if (r % side != 0) set(sparse, dense, n, r, r - 1, -1.0);
+                if (r % side != side - 1) set(sparse, dense, n, r, r + 1, -1.0);
+                if (r >= side) set(sparse, dense, n, r, r - side, -1.0);
+                if (r + side < side * side) set(sparse, dense, n, r, r + side, -1.0);
+            }
+        } else if (pattern == "random") {
+            const auto cells = static_cast<std::size_t>(density * static_cast<double>(n * n));
+            for (std::size_t i = 0; i < cells; ++i) set(sparse, dense, n, rng() % n, rng() % n, value(rng));
+        } else {
+            // row r gets about average_length * n / ((r + 1) * H(n)) cells, H(n) the harmonic number
+            const double average_length = density * static_cast<double>(n);
+            double harmonic = 0;
+            for (std::size_t r = 1; r <= n; ++r) harmonic += 1.0 / static_cast<double>(r);
+            std::vector<std::size_t> rows(n);
+            std::iota(rows.begin(), rows.end(), 0);
+            std::ranges::shuffle(rows, rng);
+            for (std::size_t i = 0; i < n; ++i) {
+                const double length = average_length * static_cast<double>(n) / (static_cast<double>(i + 1) * harmonic);
+                const auto cells = std::min(n, static_cast<std::size_t>(std::ceil(length)));
+                for (std::size_t k = 0; k < cells; ++k) set(sparse, dense, n, rows[i], rng() % n, value(rng));
+            }
+        }
+    }
+
+    bool close(const double a, const double b) {
+        return std::abs(a - b) <= 1e-9 * std::max({1.0, std::abs(a), std::abs(b)});
+    }
+
+    void report(const std::string &name, const double secs, const double baseline) {
+        std::cout << "  " << std::left << std::setw(16) << name << std::right << std::fixed << std::setprecision(3)
+                << std::setw(12) << secs * 1000 << " ms" << std::setprecision(1) << std::setw(10) << baseline / secs
+                << "x\n";
+    }
+
+    bool bench_spmv(const std::string &pattern, const std::size_t n, const double density, const int repeat) {
+        SparseMatrix<double> sparse(0.0);
+        Dense dense(n * n);
+        make_pattern(pattern, n, density, sparse, dense);
+        const auto csr = sparse.freeze();
+        std::vector<double> x(n);
+        std::mt19937_64 rng(7);
+        for (auto &v: x) v = std::uniform_real_distribution(-1.0, 1.0)(rng);
+
+        std::vector<double> expected(n), y1(n), yn(n);
+        const double dense_secs = best_time(repeat, [&] {
+            for (std::size_t r = 0; r < n; ++r) {
+                double sum = 0;
+                for (std::size_t c = 0; c < n; ++c) sum += dense[r * n + c] * x[c];
+                expected[r] = sum;
+            }
+        });
+        const double one_secs = best_time(repeat, [&] { sparse_matrix::multiply(csr, x, y1, 1); });
+        const double all_secs = best_time(repeat, [&] {
+            sparse_matrix::multiply(csr, x, yn, sparse_matrix::default_workers());
+        });
+
+        std::cout << "spmv " << pattern << ": " << n << " x " << n << ", " << csr.size() << " cells\n";
+        report("dense", dense_secs, dense_secs);
+        report("csr 1 thread", one_secs, dense_secs);
+        report("csr all threads", all_secs, dense_secs);
+        for (std::size_t r = 0; r < n; ++r) {
+            if (!close(expected[r], y1[r]) || !close(expected[r], yn[r])) return false;
+        }
+        return true;
+    }
+
+    bool bench_spgemm(const std::string &pattern, const std::size_t n, const double density, const int repeat) {
+        SparseMatrix<double> sparse(0.0);
+        Dense dense(n * n);
+        make_pattern(pattern, n, density, sparse, dense);
+        const auto csr = sparse.freeze();
+
+        Dense expected(n * n);
+        const double dense_secs = best_time(repeat, [&] {
+            std::ranges::fill(expected, 0.0);
+            for (std::size_t i = 0; i < n; ++i) {
+                for (std::size_t k = 0; k < n; ++k) {
+                    const double a = dense[i * n + k];
+                    for (std::size_t j = 0; j < n; ++j) expected[i * n + j] += a * dense[k * n + j];
+                }
+            }
+        });
+        sparse_matrix::CompressedSparseMatrix<double> c1, cn;
+        const double one_secs = best_time(repeat, [&] { c1 = sparse_matrix::multiply(csr, csr, 1); });
+        const double all_secs = best_time(repeat, [&] {
+            cn = sparse_matrix::multiply(csr, csr, sparse_matrix::default_workers());
+        });
+
+        std::cout << "spgemm " << pattern << ": " << n << " x " << n << ", " << csr.size() << " cells -> "
+                << cn.size() << "\n";
+        report("dense", dense_secs, dense_secs);
+        report("csr 1 thread", one_secs, dense_secs);
+        report("csr all threads", all_secs, dense_secs);
+        for (std::size_t i = 0; i < n; ++i) {
+            const auto row1 = c1[i];
+            const auto rown = cn[i];
+            for (std::size_t j = 0; j < n; ++j) {
+                if (!close(expected[i * n + j], row1[j]) || !close(expected[i * n + j], rown[j])) return false;
+            }
+        }
+        return true;
+    }
+
+    // time of `cells` random writes, then of as many random reads (half of them hits)
+    template<class Storage>
+    std::pair<double, double> time_access(const std::size_t n, const std::size_t cells, long long &checksum) {
+        SparseMatrix<double, Storage> matrix(0.0);
+        std::mt19937_64 rng(11);
+        std::vector<std::pair<std::size_t, std::size_t> > coordinates(cells);
+        for (auto &coordinate: coordinates) coordinate = {rng() % n, rng() % n};
+
+        auto start = Clock::now();
+        for (std::size_t i = 0; i < cells; ++i) matrix[coordinates[i].first][coordinates[i].second] = 1.0 + static_cast<double>(i % 7);
+        const double write_secs = std::chrono::duration<double>(Clock::now() - start).count();
+
+        std::ranges::shuffle(coordinates, rng);
+        for (std::size_t i = 0; i < cells; i += 2) coordinates[i] = {rng() % n, rng() % n};
+        start = Clock::now();
+        double sum = 0;
+        for (const auto &[r, c]: coordinates) sum += matrix[r][c];
+        const double read_secs = std::chrono::duration<double>(Clock::now() - start).count();
+        checksum += static_cast<long long>(sum);
+        return {write_secs, read_secs};
+    }
+
+    bool bench_access(const std::size_t n, const std::size_t cells) {
+        long long nested_sum = 0, flat_sum = 0;
+        const auto [nested_write, nested_read] = time_access<sparse_matrix::NestedHashStorage<double> >(
+            n, cells, nested_sum);
+        const auto [flat_write, flat_read] = time_access<sparse_matrix::FlatHashStorage<double> >(n, cells, flat_sum);
+
+        std::cout << "access: " << cells << " random writes and reads in " << n << " x " << n << "\n";
+        report("nested write", nested_write, nested_write);
+        report("flat write", flat_write, nested_write);
+        report("nested read", nested_read, nested_read);
+        report("flat read", flat_read, nested_read);
+        return nested_sum == flat_sum;
+    }
+}
+
+int main(const int argc, char *argv[]) {
+    std::size_t n = 4096;
+    std::size_t gemm_n = 512;
+    double density = 0.002;
+    int repeat = 3;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const std::string key = argv[i];
+        if (key == "--n") n = std::stoul(argv[i + 1]);
+        else if (key == "--gemm-n") gemm_n = std::stoul(argv[i + 1]);
+        else if (key == "--density") density = std::stod(argv[i + 1]);
+        else if (key == "--repeat") repeat = std::stoi(argv[i + 1]);
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--n rows] [--gemm-n rows] [--density d] [--repeat k]\n";
+            return 1;
+        }
+    }
+    std::cout << sparse_matrix::default_workers() << " threads\n";
+
+    for (const std::string pattern: {"stencil", "random", "powerlaw"}) {
+        if (!bench_spmv(pattern, n, density, repeat) || !bench_spgemm(pattern, gemm_n, density * 4, repeat)) {
+            std::cerr << "sparse and dense results differ (" << pattern << ")\n";
+            return 1;
+        }
+    }
+    if (!bench_access(n * 16, n * 256)) {
+        std::cerr << "storages read different values\n";
+        return 1;
+    }
+    return 0;
+}
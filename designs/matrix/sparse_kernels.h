@@ -0,0 +1,176 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "compressed_sparse_matrix.h"
+
+// Multiplication kernels on the compressed (CSR) form of a sparse matrix, see freeze():
+//  - SpMV:   y = A * x, one dot product per stored row;
+//  - SpGEMM: C = A * B, row by row (Gustavson): row i of C is the sum of the rows of B selected
+//            by the cells of row i of A.
+// Rows are split between threads in ranges of about the same number of cells, so a few dense rows
+// do not leave the other threads idle. Absent cells are zero: the matrices must have default value T{}.
+// workers: threads to split the rows between; AUTO_WORKERS (the default) means every hardware thread,
+// or only the calling one below PARALLEL_MULTIPLY_THRESHOLD cells. An explicit count is always used.
+namespace sparse_matrix {
+    // below this number of cells a multiplication with AUTO_WORKERS runs on the calling thread
+    constexpr std::size_t PARALLEL_MULTIPLY_THRESHOLD = 1 << 15;
+
+    constexpr std::size_t AUTO_WORKERS = 0;
+
+    inline std::size_t default_workers() {
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    namespace detail {
+        template<class T>
+        void require_zero_default(const CompressedSparseMatrix<T> &m) {
+            if (m.default_value() != T{}) throw std::invalid_argument("multiply: default value must be zero");
+        }
+
+        // the thread count a multiplication over `cells` input cells runs with
+        inline std::size_t resolve_workers(const std::size_t workers, const std::size_t cells) {
+            if (workers != AUTO_WORKERS) return workers;
+            return cells < PARALLEL_MULTIPLY_THRESHOLD ? 1 : default_workers();
+        }
+
+        // parts + 1 bounds of row slots (indexes into row_ids), each range holding about size / parts cells
+        inline std::vector<std::size_t> balanced_row_ranges(const std::span<const std::size_t> row_offsets,
+                                                            const std::size_t parts) {
+            const std::size_t rows = row_offsets.size() - 1;
+            std::vector<std::size_t> bounds{0};
+            for (std::size_t p = 1; p < parts; ++p) {
+                const std::size_t target = row_offsets.back() * p / parts;
+                const auto it = std::ranges::lower_bound(row_offsets.first(rows), target);
+                bounds.push_back(std::max(bounds.back(), static_cast<std::size_t>(it - row_offsets.begin())));
+            }
+            bounds.push_back(rows);
+            return bounds;
+        }
+
+        // Runs work(first_slot, last_slot, part) for every range, range 0 on the calling thread.
+        template<class Work>
+        void for_row_ranges(const std::vector<std::size_t> &bounds, Work &&work) {
+            std::vector<std::jthread> threads;
+            for (std::size_t p = 1; p + 1 < bounds.size(); ++p) threads.emplace_back(work, bounds[p], bounds[p + 1], p);
+            work(bounds[0], bounds[1], std::size_t{0});
+            threads.clear(); // joins
+        }
+
+        // Sparse row times dense vector. Four independent sums instead of one: no single dependency chain
+        // through the adds, so the loop can be unrolled and vectorized (x[] loads become gathers on
+        // targets that have them, e.g. AVX2).
+        template<class T>
+        T dot(const std::span<const std::size_t> columns, const std::span<const T> values, const T *x) {
+            T s0{}, s1{}, s2{}, s3{};
+            const std::size_t n = values.size();
+            std::size_t k = 0;
+            for (; k + 4 <= n; k += 4) {
+                s0 += values[k] * x[columns[k]];
+                s1 += values[k + 1] * x[columns[k + 1]];
+                s2 += values[k + 2] * x[columns[k + 2]];
+                s3 += values[k + 3] * x[columns[k + 3]];
+            }
+            for (; k < n; ++k) s0 += values[k] * x[columns[k]];
+            return (s0 + s1) + (s2 + s3);
+        }
+
+        // rows of C computed by one thread
+        template<class T>
+        struct RowBlock {
+            std::vector<std::size_t> row_ids;
+            std::vector<std::size_t> row_sizes;
+            std::vector<std::size_t> columns;
+            std::vector<T> values;
+        };
+    }
+
+    // y = a * x; x must cover every column of a and y every row (other rows of y are set to zero)
+    template<class T>
+    void multiply(const CompressedSparseMatrix<T> &a, const std::type_identity_t<std::span<const T> > x,
+                  const std::type_identity_t<std::span<T> > y, const std::size_t workers = AUTO_WORKERS) {
+        detail::require_zero_default(a);
+        if (x.size() < a.column_count() || y.size() < a.row_count()) {
+            throw std::out_of_range("multiply: vector is shorter than the matrix");
+        }
+        std::ranges::fill(y, T{});
+
+        const auto row_ids = a.row_ids();
+        const auto offsets = a.row_offsets();
+        detail::for_row_ranges(detail::balanced_row_ranges(offsets, detail::resolve_workers(workers, a.size())),
+                               [&](const std::size_t first, const std::size_t last, std::size_t) {
+                                   for (std::size_t s = first; s < last; ++s) {
+                                       const std::size_t begin = offsets[s], count = offsets[s + 1] - begin;
+                                       y[row_ids[s]] = detail::dot(a.columns().subspan(begin, count),
+                                                                   a.values().subspan(begin, count), x.data());
+                                   }
+                               });
+    }
+
+    template<class T>
+    std::vector<T> multiply(const CompressedSparseMatrix<T> &a, const std::type_identity_t<std::span<const T> > x,
+                            const std::size_t workers = AUTO_WORKERS) {
+        std::vector<T> y(a.row_count());
+        multiply(a, x, std::span<T>(y), workers);
+        return y;
+    }
+
+    // c = a * b. The products of a row are collected as (column, value) pairs, sorted by column and summed
+    // (expand - sort - compress): this needs no dense accumulator as wide as b, whose columns may be any
+    // std::size_t. Sums that come out exactly zero are not stored.
+    template<class T>
+    CompressedSparseMatrix<T> multiply(const CompressedSparseMatrix<T> &a, const CompressedSparseMatrix<T> &b,
+                                       const std::size_t workers = AUTO_WORKERS) {
+        detail::require_zero_default(a);
+        detail::require_zero_default(b);
+        const auto bounds = detail::balanced_row_ranges(a.row_offsets(),
+                                                        detail::resolve_workers(workers, a.size() + b.size()));
+        std::vector<detail::RowBlock<T> > blocks(bounds.size() - 1);
+        detail::for_row_ranges(bounds, [&](const std::size_t first, const std::size_t last, const std::size_t part) {
+            auto &block = blocks[part];
+            std::vector<std::pair<std::size_t, T> > products;
+            for (std::size_t s = first; s < last; ++s) {
+                products.clear();
+                for (std::size_t k = a.row_offsets()[s]; k < a.row_offsets()[s + 1]; ++k) {
+                    const auto b_row = b[a.columns()[k]];
+                    const T factor = a.values()[k];
+                    for (std::size_t j = 0; j < b_row.size(); ++j) {
+                        products.emplace_back(b_row.columns()[j], factor * b_row.values()[j]);
+                    }
+                }
+                std::ranges::sort(products, {}, &std::pair<std::size_t, T>::first);
+
+                const std::size_t row_start = block.columns.size();
+                for (std::size_t i = 0; i < products.size();) {
+                    const std::size_t column = products[i].first;
+                    T sum{};
+                    for (; i < products.size() && products[i].first == column; ++i) sum += products[i].second;
+                    if (sum != T{}) {
+                        block.columns.push_back(column);
+                        block.values.push_back(sum);
+                    }
+                }
+                if (block.columns.size() > row_start) {
+                    block.row_ids.push_back(a.row_ids()[s]);
+                    block.row_sizes.push_back(block.columns.size() - row_start);
+                }
+            }
+        });
+
+        // blocks cover ascending row ranges: concatenated in order they are the CSR arrays of c
+        std::vector<std::size_t> row_ids, row_offsets{0}, columns;
+        std::vector<T> values;
+        for (const auto &block: blocks) {
+            row_ids.insert(row_ids.end(), block.row_ids.begin(), block.row_ids.end());
+            for (const auto size: block.row_sizes) row_offsets.push_back(row_offsets.back() + size);
+            columns.insert(columns.end(), block.columns.begin(), block.columns.end());
+            values.insert(values.end(), block.values.begin(), block.values.end());
+        }
+        return {T{}, std::move(row_ids), std::move(row_offsets), std::move(columns), std::move(values)};
+    }
+}
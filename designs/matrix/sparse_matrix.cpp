@@ -33,5 +33,9 @@ int main() {
         std::cout << x << ' ' << y << ' ' << value << '\n';
     }
 
+    // compressed read-only copy: same cells, same matrix[r][c] reads
+    const auto frozen = matrix.freeze();
+    std::cout << "\nFrozen: " << frozen.size() << " cells, [4][5] = " << frozen[4][5] << '\n';
+
     return 0;
 }
@@ -2,6 +2,7 @@
 #include <vector>
 #include <algorithm>
 #include <map>
+#include "compressed_sparse_matrix.h"
 
 namespace sparse_matrix {
     class SparseMatrix {
@@ -93,6 +94,14 @@ namespace sparse_matrix {
             return std::count_if(this->begin(), this->end(), [this](const auto &e) { return e.value != default_; });
         }
 
+        // Read-only compressed (CSR) copy of the matrix for when filling in is done: contiguous arrays
+        // instead of map nodes, matrix[r][c] and iteration still work on it
+        [[nodiscard]] CompressedSparseMatrix<int> freeze() const {
+            std::vector<CompressedSparseMatrix<int>::Entry> entries;
+            for (const auto &[x, y, value]: *this) entries.push_back({x, y, value}); // already row-major
+            return {default_, std::move(entries)};
+        }
+
 
         class Row {
             SparseMatrix &parent_;
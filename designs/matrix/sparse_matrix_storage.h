@@ -0,0 +1,306 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Storage policies of SparseMatrix<T, Storage> (sparse_matrix_template.h). A storage keeps the
+// non-default cells and offers:
+//   const T *find(row, col) const        - the cell or nullptr;
+//   void insert_or_assign(row, col, v);
+//   void erase(row, col);
+//   std::size_t size() const             - number of cells;
+//   begin() / end()                      - const iterators with row(), column() and value(), in no
+//                                          particular order.
+namespace sparse_matrix {
+    // row -> (column -> value): two hash lookups per access, one hash map allocation per row
+    template<class T>
+    class NestedHashStorage {
+        using Rows = std::unordered_map<std::size_t, std::unordered_map<std::size_t, T> >;
+
+    public:
+        class const_iterator {
+            const Rows *rows_ = nullptr;
+            typename Rows::const_iterator outer_;
+            typename Rows::mapped_type::const_iterator inner_;
+
+            void skip_empty_rows() {
+                while (outer_ != rows_->end() && inner_ == outer_->second.end()) {
+                    ++outer_;
+                    if (outer_ != rows_->end()) inner_ = outer_->second.begin();
+                }
+            }
+
+        public:
+            const_iterator() = default;
+
+            const_iterator(const Rows *rows, const typename Rows::const_iterator outer)
+                : rows_(rows), outer_(outer) {
+                if (outer_ != rows_->end()) inner_ = outer_->second.begin();
+                skip_empty_rows();
+            }
+
+            [[nodiscard]] std::size_t row() const { return outer_->first; }
+            [[nodiscard]] std::size_t column() const { return inner_->first; }
+            [[nodiscard]] const T &value() const { return inner_->second; }
+
+            const_iterator &operator++() {
+                ++inner_;
+                skip_empty_rows();
+                return *this;
+            }
+
+            bool operator==(const const_iterator &other) const {
+                return outer_ == other.outer_ && (outer_ == rows_->end() || inner_ == other.inner_);
+            }
+        };
+
+        const T *find(const std::size_t r, const std::size_t c) const {
+            const auto it_row = rows_.find(r);
+            if (it_row == rows_.end()) return nullptr;
+            const auto it_col = it_row->second.find(c);
+            return it_col == it_row->second.end() ? nullptr : &it_col->second;
+        }
+
+        void insert_or_assign(const std::size_t r, const std::size_t c, const T &v) {
+            if (rows_[r].insert_or_assign(c, v).second) ++size_;
+        }
+
+        void erase(const std::size_t r, const std::size_t c) {
+            const auto it_row = rows_.find(r);
+            if (it_row == rows_.end()) return;
+            size_ -= it_row->second.erase(c);
+            if (it_row->second.empty()) rows_.erase(it_row);
+        }
+
+        [[nodiscard]] std::size_t size() const noexcept { return size_; }
+
+        const_iterator begin() const { return const_iterator(&rows_, rows_.begin()); }
+        const_iterator end() const { return const_iterator(&rows_, rows_.end()); }
+
+    private:
+        Rows rows_;
+        std::size_t size_ = 0;
+    };
+
+    namespace detail {
+        // 16 control bytes of a flat hash table, compared at once: SSE2 where available, a loop otherwise.
+        // Control byte: EMPTY, DELETED (both have the sign bit set) or the high 7 bits of the key hash of a
+        // full slot. Results are bit masks, bit i for byte i.
+        class ControlGroup {
+        public:
+            static constexpr std::size_t WIDTH = 16;
+            static constexpr std::int8_t EMPTY = -128;
+            static constexpr std::int8_t DELETED = -2;
+
+            explicit ControlGroup(const std::int8_t *ctrl) {
+#if defined(__SSE2__)
+                bytes_ = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ctrl));
+#else
+                for (std::size_t i = 0; i < WIDTH; ++i) bytes_[i] = ctrl[i];
+#endif
+            }
+
+            [[nodiscard]] std::uint32_t match(const std::int8_t h2) const {
+#if defined(__SSE2__)
+                return static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes_, _mm_set1_epi8(h2))));
+#else
+                std::uint32_t mask = 0;
+                for (std::size_t i = 0; i < WIDTH; ++i) mask |= static_cast<std::uint32_t>(bytes_[i] == h2) << i;
+                return mask;
+#endif
+            }
+
+            [[nodiscard]] std::uint32_t match_empty() const { return match(EMPTY); }
+
+            [[nodiscard]] std::uint32_t match_empty_or_deleted() const {
+#if defined(__SSE2__)
+                return static_cast<std::uint32_t>(_mm_movemask_epi8(bytes_)); // the sign bits
+#else
+                std::uint32_t mask = 0;
+                for (std::size_t i = 0; i < WIDTH; ++i) mask |= static_cast<std::uint32_t>(bytes_[i] < 0) << i;
+                return mask;
+#endif
+            }
+
+        private:
+#if defined(__SSE2__)
+            __m128i bytes_;
+#else
+            std::int8_t bytes_[WIDTH];
+#endif
+        };
+
+        // murmur3 finalizer: every key bit affects the low (slot) and the high (control byte) bits
+        constexpr std::uint64_t mix(std::uint64_t key) {
+            key ^= key >> 33;
+            key *= 0xff51afd7ed558ccdULL;
+            key ^= key >> 33;
+            key *= 0xc4ceb9fe1a85ec53ULL;
+            key ^= key >> 33;
+            return key;
+        }
+    }
+
+    // One open-addressing table (SwissTable layout) keyed by (row << 32 | col):
+    //  - a lookup hashes once, then compares 16 control bytes per SIMD instruction; the key and the value
+    //    sit in the same slot, so a hit costs the control group and one slot;
+    //  - no allocation per row or cell: about sizeof(key + value) + 1 control byte per slot, at up to 7/8 load;
+    //  - rows and columns are limited to 32 bits (std::out_of_range otherwise).
+    template<class T>
+    class FlatHashStorage {
+        using Group = detail::ControlGroup;
+
+        struct Slot {
+            std::uint64_t key;
+            T value;
+        };
+
+    public:
+        class const_iterator {
+            const FlatHashStorage *parent_ = nullptr;
+            std::size_t index_ = 0;
+
+            void skip_free_slots() {
+                while (index_ < parent_->slots_.size() && parent_->ctrl_[index_] < 0) ++index_;
+            }
+
+        public:
+            const_iterator() = default;
+
+            const_iterator(const FlatHashStorage *p, const std::size_t index) : parent_(p), index_(index) {
+                skip_free_slots();
+            }
+
+            [[nodiscard]] std::size_t row() const { return parent_->slots_[index_].key >> 32; }
+            [[nodiscard]] std::size_t column() const { return parent_->slots_[index_].key & 0xFFFF'FFFF; }
+            [[nodiscard]] const T &value() const { return parent_->slots_[index_].value; }
+
+            const_iterator &operator++() {
+                ++index_;
+                skip_free_slots();
+                return *this;
+            }
+
+            bool operator==(const const_iterator &other) const { return index_ == other.index_; }
+        };
+
+        const T *find(const std::size_t r, const std::size_t c) const {
+            if (r > UINT32_MAX || c > UINT32_MAX || size_ == 0) return nullptr;
+            const std::size_t i = find_slot(pack(r, c));
+            return i == NOT_FOUND ? nullptr : &slots_[i].value;
+        }
+
+        void insert_or_assign(const std::size_t r, const std::size_t c, const T &v) {
+            if (r > UINT32_MAX || c > UINT32_MAX) throw std::out_of_range("FlatHashStorage: coordinate over 32 bits");
+            const std::uint64_t key = pack(r, c);
+            if (!slots_.empty()) {
+                if (const std::size_t i = find_slot(key); i != NOT_FOUND) {
+                    slots_[i].value = v;
+                    return;
+                }
+            }
+            if (growth_left_ == 0) {
+                // mostly DELETED slots: rebuilding at the same capacity is enough
+                const bool grow = size_ + 1 > capacity() * 7 / 16;
+                rehash(grow ? std::max(capacity() * 2, Group::WIDTH) : capacity());
+            }
+            const std::uint64_t h = detail::mix(key);
+            const std::size_t i = free_slot(h);
+            growth_left_ -= ctrl_[i] == Group::EMPTY; // reusing a DELETED slot does not take space
+            set_ctrl(i, h2(h));
+            slots_[i] = Slot{key, v};
+            ++size_;
+        }
+
+        void erase(const std::size_t r, const std::size_t c) {
+            if (r > UINT32_MAX || c > UINT32_MAX || size_ == 0) return;
+            const std::size_t i = find_slot(pack(r, c));
+            if (i == NOT_FOUND) return;
+            set_ctrl(i, Group::DELETED); // probing must go on past it, so it does not become EMPTY
+            slots_[i] = Slot{};
+            --size_;
+        }
+
+        [[nodiscard]] std::size_t size() const noexcept { return size_; }
+
+        const_iterator begin() const { return const_iterator(this, 0); }
+        const_iterator end() const { return const_iterator(this, slots_.size()); }
+
+    private:
+        static constexpr std::size_t NOT_FOUND = SIZE_MAX;
+
+        // control bytes: capacity, followed by a copy of the first WIDTH, so a group read near the end
+        // does not wrap around
+        std::vector<std::int8_t> ctrl_;
+        std::vector<Slot> slots_;
+        std::size_t size_ = 0;
+        std::size_t growth_left_ = 0; // EMPTY slots that may still be filled before a rehash
+
+        static constexpr std::uint64_t pack(const std::size_t r, const std::size_t c) {
+            return static_cast<std::uint64_t>(r) << 32 | static_cast<std::uint64_t>(c);
+        }
+
+        static constexpr std::int8_t h2(const std::uint64_t h) { return static_cast<std::int8_t>(h >> 57); }
+
+        [[nodiscard]] std::size_t capacity() const noexcept { return slots_.size(); }
+
+        void set_ctrl(const std::size_t i, const std::int8_t value) {
+            ctrl_[i] = value;
+            if (i < Group::WIDTH) ctrl_[capacity() + i] = value;
+        }
+
+        // Groups are probed at triangular offsets (h, h + 16, h + 48, ...): with a power of two capacity
+        // every group is visited.
+        std::size_t find_slot(const std::uint64_t key) const {
+            const std::uint64_t h = detail::mix(key);
+            const std::size_t mask = capacity() - 1;
+            std::size_t pos = h & mask;
+            for (std::size_t step = Group::WIDTH;; step += Group::WIDTH) {
+                const Group group(&ctrl_[pos]);
+                for (std::uint32_t m = group.match(h2(h)); m != 0; m &= m - 1) {
+                    const std::size_t i = (pos + static_cast<std::size_t>(std::countr_zero(m))) & mask;
+                    if (slots_[i].key == key) return i;
+                }
+                if (group.match_empty() != 0) return NOT_FOUND;
+                pos = (pos + step) & mask;
+            }
+        }
+
+        // first EMPTY or DELETED slot on the probe sequence of hash h
+        std::size_t free_slot(const std::uint64_t h) const {
+            const std::size_t mask = capacity() - 1;
+            std::size_t pos = h & mask;
+            for (std::size_t step = Group::WIDTH;; step += Group::WIDTH) {
+                if (const std::uint32_t m = Group(&ctrl_[pos]).match_empty_or_deleted(); m != 0) {
+                    return (pos + static_cast<std::size_t>(std::countr_zero(m))) & mask;
+                }
+                pos = (pos + step) & mask;
+            }
+        }
+
+        // rebuilds the table with new_capacity slots (a power of two), dropping DELETED markers
+        void rehash(const std::size_t new_capacity) {
+            auto old_ctrl = std::move(ctrl_);
+            auto old_slots = std::move(slots_);
+            ctrl_.assign(new_capacity + Group::WIDTH, Group::EMPTY);
+            slots_.assign(new_capacity, Slot{});
+            growth_left_ = new_capacity - new_capacity / 8 - size_;
+            for (std::size_t i = 0; i < old_slots.size(); ++i) {
+                if (old_ctrl[i] < 0) continue;
+                const std::uint64_t h = detail::mix(old_slots[i].key);
+                const std::size_t j = free_slot(h);
+                set_ctrl(j, h2(h));
+                slots_[j] = std::move(old_slots[i]);
+            }
+        }
+    };
+}
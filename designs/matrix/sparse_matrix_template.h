@@ -1,10 +1,17 @@
 #pragma once
 #include <cstddef>
+#include <cstdint>
 #include <functional>
-#include <unordered_map>
+#include <optional>
+#include <vector>
+#include "compressed_sparse_matrix.h"
+#include "sparse_matrix_storage.h"
 
 
-template<class T>
+// Storage - where the cells live, see sparse_matrix_storage.h:
+//   NestedHashStorage - row → (column → value) hash maps (default);
+//   FlatHashStorage   - one open-addressing table keyed by packed (row, column), for random access.
+template<class T, class Storage = sparse_matrix::NestedHashStorage<T> >
 class SparseMatrix {
 public:
     using Coordinates = std::pair<std::size_t, std::size_t>;
@@ -15,34 +22,53 @@ public:
     explicit SparseMatrix(T default_value) : def_(default_value) {
     }
 
+    // number of stored (non-default) cells
     [[nodiscard]] std::size_t size() const noexcept { return data_.size(); }
 
+    // Read-only compressed (CSR) copy of the matrix for when filling in is done: contiguous arrays
+    // instead of hash map nodes, matrix[r][c] and iteration (row-major) still work on it.
+    // Built for the caller only - not kept as the index of the ordered reads below, so the matrix
+    // does not hold a second compressed copy (an index already built is copied instead of re-sorted).
+    [[nodiscard]] sparse_matrix::CompressedSparseMatrix<T> freeze() const {
+        return row_index_ ? *row_index_ : make_row_index();
+    }
+
+    // Ordered reads. Iteration over the matrix itself follows the storage order (none for the hash
+    // storages); these slices are read from compressed indexes instead - row-major CSR for ordered(),
+    // row() and block(), a CSR of the transposed matrix for col(). An index is built on the first such
+    // read after a change, so a slice costs a binary search per non-empty row it spans plus its cells.
+    // Slices stay valid until the matrix is changed. Not thread-safe even when const: a read may build
+    // an index.
+    using Slice = typename sparse_matrix::CompressedSparseMatrix<T>::Slice;
+
+    // all cells, by row, then column
+    Slice ordered() const { return row_index().slice(0, SIZE_MAX, 0, SIZE_MAX); }
+
+    // cells of row r, by column
+    Slice row(const std::size_t r) const { return row_index().slice(r, r, 0, SIZE_MAX); }
+
+    // cells of column c, by row
+    Slice col(const std::size_t c) const { return column_index().slice(c, c, 0, SIZE_MAX, true); }
+
+    // cells with r0 <= row < r1 and c0 <= column < c1, by row, then column
+    Slice block(const std::size_t r0, const std::size_t c0, const std::size_t r1, const std::size_t c1) const {
+        if (r1 <= r0 || c1 <= c0) return row_index().slice(1, 0, 1, 0); // empty
+        return row_index().slice(r0, r1 - 1, c0, c1 - 1);
+    }
+
     // to enable 2D array syntax matrix[row][col] for accessing elements in the sparse matrix - getting row
     class RowProxy;
     RowProxy operator[](std::size_t row) { return RowProxy(*this, row); }
     // do also const implementation as usual
     RowProxy operator[](std::size_t row) const { return RowProxy(const_cast<SparseMatrix &>(*this), row); }
 
-    struct Entry {
-        std::size_t x, y;
-        T value;
-    };
+    // the same cell type as on the compressed form
+    using Entry = typename sparse_matrix::CompressedSparseMatrix<T>::Entry;
 
     class iterator {
-        // iterating over cells (inner iterator) and rows (outer iterator)
-        using OuterIt = typename std::unordered_map<std::size_t, std::unordered_map<std::size_t, T> >::const_iterator;
-        using InnerIt = typename std::unordered_map<std::size_t, T>::const_iterator;
-
-        const SparseMatrix *parent_;
-        OuterIt outer_;
-        InnerIt inner_;
-
-        void advance_to_next_valid() {
-            while (outer_ != parent_->data_.end() && inner_ == outer_->second.end()) {
-                ++outer_;
-                if (outer_ != parent_->data_.end()) inner_ = outer_->second.begin();
-            }
-        }
+        using StorageIt = typename Storage::const_iterator;
+
+        StorageIt it_;
 
     public:
         using iterator_category = std::forward_iterator_tag;
@@ -51,75 +77,80 @@ public:
         using pointer = const Entry *;
         using reference = const Entry &;
 
-        iterator(const SparseMatrix *p, OuterIt o, InnerIt i)
-            : parent_(p), outer_(o), inner_(i) { advance_to_next_valid(); }
+        explicit iterator(const StorageIt it) : it_(it) {
+        }
 
         iterator &operator++() {
-            ++inner_;
-            if (inner_ == outer_->second.end()) {
-                ++outer_;
-                if (outer_ != parent_->data_.end())
-                    inner_ = outer_->second.begin();
-            }
-            advance_to_next_valid();
+            ++it_;
             return *this;
         }
 
         Entry operator*() const {
-            return Entry{outer_->first, inner_->first, inner_->second};
+            return Entry{it_.row(), it_.column(), it_.value()};
         }
 
-        bool operator==(const iterator &other) const {
-            return outer_ == other.outer_ && (outer_ == parent_->data_.end() || inner_ == other.inner_);
-        }
+        bool operator==(const iterator &other) const { return it_ == other.it_; }
 
         bool operator!=(const iterator &other) const { return !(*this == other); }
     };
 
-    iterator begin() const noexcept {
-        return iterator(this, data_.begin(),
-                        data_.empty()
-                            ? typename std::unordered_map<std::size_t, T>::const_iterator()
-                            : data_.begin()->second.begin());
-    }
+    iterator begin() const noexcept { return iterator(data_.begin()); }
 
-    iterator end() const noexcept { return iterator(this, data_.end(), {}); }
+    iterator end() const noexcept { return iterator(data_.end()); }
 
 private:
     T def_{-1}; // default value
 
-    std::unordered_map<std::size_t, std::unordered_map<std::size_t, T> > data_; // row → (column → value)
+    Storage data_; // non-default cells
+    // ordered indexes, built on demand and dropped on every change
+    mutable std::optional<sparse_matrix::CompressedSparseMatrix<T> > row_index_;
+    mutable std::optional<sparse_matrix::CompressedSparseMatrix<T> > column_index_;
 
     friend class RowProxy;
 
-    T get(std::size_t r, std::size_t c) const {
-        auto it_row = data_.find(r);
-        if (it_row != data_.end()) {
-            auto it_col = it_row->second.find(c);
-            if (it_col != it_row->second.end())
-                return it_col->second;
+    sparse_matrix::CompressedSparseMatrix<T> make_row_index() const {
+        std::vector<Entry> entries;
+        entries.reserve(data_.size());
+        for (const auto &entry: *this) entries.push_back(entry);
+        return {def_, std::move(entries)};
+    }
+
+    const sparse_matrix::CompressedSparseMatrix<T> &row_index() const {
+        if (!row_index_) row_index_.emplace(make_row_index());
+        return *row_index_;
+    }
+
+    // the transposed matrix: its rows are the columns
+    const sparse_matrix::CompressedSparseMatrix<T> &column_index() const {
+        if (!column_index_) {
+            std::vector<Entry> entries;
+            entries.reserve(data_.size());
+            for (const auto &[x, y, value]: *this) entries.push_back({y, x, value});
+            column_index_.emplace(def_, std::move(entries));
         }
-        return def_;
+        return *column_index_;
+    }
+
+    T get(std::size_t r, std::size_t c) const {
+        const T *value = data_.find(r, c);
+        return value ? *value : def_;
     }
 
     void set(std::size_t r, std::size_t c, const T &v) {
+        row_index_.reset();
+        column_index_.reset();
         if (v == def_) {
             // erase if present
-            auto itRow = data_.find(r);
-            if (itRow != data_.end()) {
-                itRow->second.erase(c);
-                if (itRow->second.empty())
-                    data_.erase(itRow);
-            }
+            data_.erase(r, c);
         }
         else {
-            data_[r][c] = v;
+            data_.insert_or_assign(r, c, v);
         }
     }
 };
 
-template<class T>
-class SparseMatrix<T>::RowProxy {
+template<class T, class Storage>
+class SparseMatrix<T, Storage>::RowProxy {
     SparseMatrix &parent_;
     std::size_t row_;
 
@@ -0,0 +1,59 @@
+#define BOOST_TEST_MODULE test_ip_output
+
+#include "designs/ip_filter/ip_output.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdio>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+	// runs write(out) on a temporary file and returns what was written
+	template<typename Write>
+	std::vector<unsigned char> written(const IpWriter::Format format, Write write) {
+		std::FILE *file = std::tmpfile();
+		BOOST_REQUIRE(file != nullptr);
+		{
+			IpWriter out(fileno(file), format);
+			write(out);
+		}
+		std::vector<unsigned char> bytes(static_cast<std::size_t>(::lseek(fileno(file), 0, SEEK_END)));
+		BOOST_REQUIRE(::pread(fileno(file), bytes.data(), bytes.size(), 0) == static_cast<ssize_t>(bytes.size()));
+		std::fclose(file);
+		return bytes;
+	}
+
+	IPAddress read_record(const std::vector<unsigned char> &bytes, const std::size_t offset) {
+		std::uint64_t hi = 0, lo = 0;
+		for (std::size_t i = 0; i < 8; ++i) hi = hi << 8 | bytes[offset + i];
+		for (std::size_t i = 8; i < 16; ++i) lo = lo << 8 | bytes[offset + i];
+		return {hi, lo};
+	}
+}
+
+BOOST_AUTO_TEST_SUITE(test_ip_output)
+
+BOOST_AUTO_TEST_CASE(test_binary_ipv4_records) {
+	const auto bytes = written(IpWriter::Format::BINARY, [](IpWriter &out) {
+		out.write(IPv4Address(1, 2, 3, 4));
+		out.write(IPv4Address(46, 70, 0, 255));
+	});
+	BOOST_CHECK(bytes == std::vector<unsigned char>({1, 2, 3, 4, 46, 70, 0, 255}));
+}
+
+BOOST_AUTO_TEST_CASE(test_binary_mapped_records) {
+	const std::vector<IPAddress> expected = {
+		parse_ip("2001:db8::1"), IPAddress(IPv4Address(46, 70, 225, 39)), IPAddress(IPv4Address(1, 1, 234, 8)),
+	};
+	const auto bytes = written(IpWriter::Format::BINARY_MAPPED, [](IpWriter &out) {
+		out.write(parse_ip("2001:db8::1"));
+		out.write(IPv4Address(46, 70, 225, 39)); // IPv4 records are widened too
+		const std::vector<IPv4Address> filtered = {IPv4Address(1, 1, 234, 8)};
+		out.write(filtered);
+	});
+	BOOST_REQUIRE_EQUAL(bytes.size(), expected.size() * 16);
+	for (std::size_t i = 0; i < expected.size(); ++i) BOOST_CHECK(read_record(bytes, i * 16) == expected[i]);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,84 @@
+#define BOOST_TEST_MODULE test_wal
+
+#include "designs/bulk_cmd_parser/wal.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+	// temporary WAL path, removed at the end of the test
+	struct TempLog {
+		const std::string path = (std::filesystem::temp_directory_path() /
+		                          ("test_wal_" + std::to_string(::getpid()) + ".log")).string();
+
+		TempLog() { std::filesystem::remove(path); }
+		~TempLog() { std::filesystem::remove(path); }
+
+		[[nodiscard]] std::string contents() const {
+			std::ifstream in(path, std::ios::binary);
+			return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+		}
+	};
+
+	std::vector<std::string> commands(const Block &b) {
+		return {b.commands.begin(), b.commands.end()};
+	}
+}
+
+BOOST_AUTO_TEST_SUITE(test_wal)
+
+BOOST_AUTO_TEST_CASE(test_recover_unfinished_block) {
+	const TempLog log;
+	{
+		// block size 2: "a, b" is written and done; the dynamic block "c, d" is still open at the "crash"
+		WriteAheadLog wal(log.path, 2, FlushPolicy{}, std::chrono::milliseconds(1));
+		for (const auto *line: {"a", "b"}) wal.log_line(line);
+		wal.block_done(wal.block_dispatched());
+		for (const auto *line: {"{", "c", "d"}) wal.log_line(line);
+	} // the destructor commits what was logged, as the writer thread would have before a crash
+
+	// the block size of the crashed run comes from the log header
+	const auto blocks = WriteAheadLog::recover(log.path, FlushPolicy{});
+	BOOST_REQUIRE_EQUAL(blocks.size(), 1u);
+	BOOST_CHECK(commands(blocks[0]) == std::vector<std::string>({"c", "d"}));
+}
+
+BOOST_AUTO_TEST_CASE(test_recover_unacknowledged_static_block) {
+	const TempLog log;
+	{
+		WriteAheadLog wal(log.path, 2, FlushPolicy{}, std::chrono::milliseconds(1));
+		for (const auto *line: {"a", "b"}) wal.log_line(line);
+		wal.block_dispatched(); // dispatched, but no sink finished it
+		wal.log_line("c");
+	}
+	const auto blocks = WriteAheadLog::recover(log.path, FlushPolicy{});
+	BOOST_REQUIRE_EQUAL(blocks.size(), 2u);
+	BOOST_CHECK(commands(blocks[0]) == std::vector<std::string>({"a", "b"}));
+	BOOST_CHECK(commands(blocks[1]) == std::vector<std::string>({"c"}));
+}
+
+BOOST_AUTO_TEST_CASE(test_compact_leaves_header) {
+	const TempLog log;
+	{
+		WriteAheadLog wal(log.path, 3, FlushPolicy{}, std::chrono::milliseconds(1));
+		for (const auto *line: {"a", "b", "c"}) wal.log_line(line);
+		wal.block_done(wal.block_dispatched());
+		wal.compact();
+	}
+	BOOST_CHECK_EQUAL(log.contents(), "h 3 0 0\n");
+	BOOST_CHECK(WriteAheadLog::recover(log.path, FlushPolicy{}).empty());
+}
+
+BOOST_AUTO_TEST_CASE(test_log_without_header_is_refused) {
+	const TempLog log;
+	std::ofstream(log.path) << "l a\nl b\n";
+	BOOST_CHECK_THROW(WriteAheadLog::recover(log.path, FlushPolicy{}), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()